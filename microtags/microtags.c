@@ -22,27 +22,871 @@
  * Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#ifdef MICROTAGS_HOST
+    /* for CLOCK_MONOTONIC_RAW and syscall() */
+    #define _GNU_SOURCE
+#endif
+
 #include "microtags.h"
 
-#ifndef MICROTAGS_N_MAX
-    #define MICROTAGS_N_MAX 128
+#ifdef MICROTAGS_INLINE
+
+    /* buffer and tick source are shared with the inline fast path */
+    #include "microtags_inline.h"
+
+    #define MICROTAGS_SHARED
+
+#else
+
+    #define MICROTAGS_SHARED static
+
+#endif
+
+#if defined(MICROTAGS_HOST) && !defined(MICROTAGS_GET_TICKS)
+
+    #include <time.h>
+
+    #define MICROTAGS_GET_TICKS() ((uint32_t)microtags_host_ticks())
+
+    /* the upper 32 bits of the ticks are known, such that epoch markers
+     * are set automatically (see microtags_set_ticks()) */
+    #define MICROTAGS_HOST_EPOCH
+
+    /*
+     * Function to return the monotonic time in ns
+     * _______________________________________________________________________
+     */
+    static inline uint64_t microtags_host_ticks(void) {
+
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+
+        return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    }
+
+#endif
+
+#ifndef MICROTAGS_GET_TICKS
+
+    #define MICROTAGS_GET_TICKS() microtags_get_ticks()
+
+    /* externally defined function to return current tick counter */
+    extern uint32_t microtags_get_ticks(void);
+
+#endif
+
+#ifndef MICROTAGS_BLOCK_SIZE
+    #define MICROTAGS_BLOCK_SIZE \
+        (MICROTAGS_BLOCK_HEADER_SIZE + 32 * MICROTAGS_RECORD_SIZE)
+#endif
+
+#if MICROTAGS_BLOCK_SIZE < (MICROTAGS_BLOCK_HEADER_SIZE + MICROTAGS_VARINT_MAX)
+    #error "MICROTAGS_BLOCK_SIZE too small to hold a single microtag"
+#endif
+
+#if MICROTAGS_BLOCK_SIZE > (MICROTAGS_BLOCK_HEADER_SIZE + 0xFFFF)
+    #error "MICROTAGS_BLOCK_SIZE exceeds maximum block length"
+#endif
+
+#ifndef MICROTAGS_KEYFRAME_INTERVAL
+    #define MICROTAGS_KEYFRAME_INTERVAL 64
+#endif
+
+#if defined(MICROTAGS_STREAM) && defined(MICROTAGS_ATOMIC)
+    #error "MICROTAGS_STREAM and MICROTAGS_ATOMIC cannot be combined"
+#endif
+
+#if defined(MICROTAGS_COMPACT) \
+        && (defined(MICROTAGS_STREAM) || defined(MICROTAGS_ATOMIC))
+    #error "MICROTAGS_COMPACT cannot be combined with STREAM or ATOMIC"
+#endif
+
+#if defined(MICROTAGS_HOST) && (defined(MICROTAGS_STREAM) \
+        || defined(MICROTAGS_ATOMIC) || defined(MICROTAGS_COMPACT) \
+                || defined(MICROTAGS_INLINE))
+    #error "MICROTAGS_HOST cannot be combined with other buffer modes"
+#endif
+
+
+#if defined(MICROTAGS_STREAM)
+
+    #include "../ringbuffers/ringbuffer.h"
+
+    #if !defined(MICROTAGS_STREAM_SIZE) && defined(RINGBUFFER_POW2)
+
+        /* a number with all bits below its most significant one set */
+        #define MICROTAGS_SMEAR(x, shift)   ((x) | ((x) >> (shift)))
+        #define MICROTAGS_SMEAR_ALL(x) \
+            MICROTAGS_SMEAR(MICROTAGS_SMEAR(MICROTAGS_SMEAR( \
+                    MICROTAGS_SMEAR(MICROTAGS_SMEAR(x, 1), 2), 4), 8), 16)
+
+        /* rounded up to the next power of two */
+        #define MICROTAGS_STREAM_SIZE (MICROTAGS_SMEAR_ALL( \
+                MICROTAGS_N_MAX * MICROTAGS_RECORD_SIZE - 1) + 1)
+
+    #elif !defined(MICROTAGS_STREAM_SIZE)
+        #define MICROTAGS_STREAM_SIZE (MICROTAGS_N_MAX * MICROTAGS_RECORD_SIZE)
+    #endif
+
+    #if defined(RINGBUFFER_POW2) \
+            && ((MICROTAGS_STREAM_SIZE) & ((MICROTAGS_STREAM_SIZE) - 1)) != 0
+        #error "MICROTAGS_STREAM_SIZE must be a power of two with RINGBUFFER_POW2"
+    #endif
+
+    /* guards (short) accesses to the ring buffer if microtags are set from
+     * a context that may preempt microtags_pump() or vice versa, e.g.
+     * by saving and disabling interrupts (default: no guard) */
+    #ifndef MICROTAGS_LOCK
+        #define MICROTAGS_LOCK()
+        #define MICROTAGS_UNLOCK()
+    #endif
+
+    /* the memory backing the ring buffer */
+    static uint8_t mem_microtags[MICROTAGS_STREAM_SIZE];
+
+    /* the ring buffer to hold packed microtags until being pumped out */
+    static ringbuffer_t rb_microtags = {
+            .buffer = mem_microtags, .size = MICROTAGS_STREAM_SIZE };
+
+    /* the number of microtags dropped due to a full ring buffer */
+    static uint32_t n_microtags_dropped = 0;
+
+    /* the text line of the microtag currently being pumped out ... */
+    static uint8_t line_microtags[MICROTAGS_TEXT_SIZE];
+
+    /* ... and the number of bytes of it already sent out */
+    static uint_fast8_t n_line_sent = MICROTAGS_TEXT_SIZE;
+
+#elif defined(MICROTAGS_ATOMIC)
+
+    #include "microtags_atomic.h"
+
+    /* the number of buffer slots reserved by writers (incl. those still
+     * being written to by a preempted context) */
+    MICROTAGS_SHARED microtags_atomic_t n_microtags = 0;
+
+    /* the number of buffer slots that have been completely written */
+    MICROTAGS_SHARED microtags_atomic_t n_microtags_committed = 0;
+
+    /* the buffer to hold microtags between being set and being sent out */
+    MICROTAGS_SHARED microtag_t buf_microtags[MICROTAGS_N_MAX];
+
+#elif defined(MICROTAGS_HOST)
+
+    #include <stdlib.h>
+    #include <stdatomic.h>
+    #include <pthread.h>
+    #include <unistd.h>
+    #include <sys/syscall.h>
+
+    #ifndef MICROTAGS_HOST_CHUNK_N
+        #define MICROTAGS_HOST_CHUNK_N 4096
+    #endif
+
+    /* a chunk of microtags recorded by a single thread */
+    typedef struct microtags_chunk {
+
+        /* the next chunk in the list the chunk is part of */
+        struct microtags_chunk* next;
+
+        /* the id of the thread the microtags have been recorded by */
+        uint32_t tid;
+
+        /* the number of microtags in the chunk */
+        uint32_t n;
+
+        microtag_t tags[MICROTAGS_HOST_CHUNK_N];
+
+    } microtags_chunk_t;
+
+    /* the chunk the calling thread currently records into */
+    static _Thread_local microtags_chunk_t* chunk_microtags = 0;
+
+    /* the chunks handed over to the collector (most recent first) */
+    static _Atomic(microtags_chunk_t*) chunks_handed_over = 0;
+
+    /* the chunks taken over by the collector (oldest first) ... */
+    static microtags_chunk_t* chunks_collected = 0;
+    static microtags_chunk_t* chunks_collected_last = 0;
+
+    /* ... and the number of microtags therein (including one thread
+     * marker microtag per chunk) */
+    static uint_fast32_t n_microtags = 0;
+
+    /* the chunk being loaded from and the position therein (0: thread
+     * marker, i > 0: microtag i - 1) */
+    static microtags_chunk_t* chunk_loaded = 0;
+    static uint_fast32_t pos_loaded = 0;
+
+    /* the key used to hand over a thread's chunk when it terminates */
+    static pthread_key_t key_microtags;
+    static pthread_once_t once_microtags = PTHREAD_ONCE_INIT;
+
+#elif defined(MICROTAGS_COMPACT)
+
+    /* by default, use the same amount of memory as MICROTAGS_N_MAX
+     * microtags would occupy in the default layout */
+    #ifndef MICROTAGS_N_SLOTS
+        #define MICROTAGS_N_SLOTS (MICROTAGS_N_MAX * sizeof(microtag_t) \
+                / sizeof(uint32_t))
+    #endif
+
+    /* values of the lower half of a slot announcing an extension slot */
+    #define MICROTAGS_COMPACT_TICKS 0xFFFF
+    #define MICROTAGS_COMPACT_DATA  0xFFFE
+
+    /* the counter to hold the current number of used slots in the buffer */
+    static uint_fast16_t n_microtags = 0;
+
+    /* the buffer to hold microtags between being set and being sent out:
+     * each microtag takes one 4-byte slot holding the 16-bit id (upper
+     * half) and the 16-bit difference of ticks to the previous ticks-based
+     * microtag (lower half). If the difference does not fit, or for data-
+     * based microtags, the lower half holds one of the MICROTAGS_COMPACT_*
+     * values and the full 32-bit ticks/data follow in an extension slot */
+    static uint32_t buf_microtags[MICROTAGS_N_SLOTS];
+
+    /* the ticks of the most recent ticks-based microtag in the buffer ... */
+    static uint32_t ticks_microtags;
+
+    /* ... and whether there is such a microtag at all */
+    static uint_fast8_t ticks_microtags_valid = 0;
+
+#else
+
+    /* the counter to hold the current number of microtags in the buffer */
+    MICROTAGS_SHARED uint_fast16_t n_microtags = 0;
+
+    /* the buffer to hold microtags between being set and being sent out */
+    MICROTAGS_SHARED microtag_t buf_microtags[MICROTAGS_N_MAX];
+
+#endif
+
+/* the staging buffer to assemble binary blocks in */
+static uint8_t buf_block[MICROTAGS_BLOCK_SIZE];
+
+/* the maximum number of payload bytes in a binary block (a multiple of the
+ * packed record size such that packed blocks are filled up completely) */
+#define MICROTAGS_BLOCK_PAYLOAD_MAX ((MICROTAGS_BLOCK_SIZE \
+        - MICROTAGS_BLOCK_HEADER_SIZE) / MICROTAGS_RECORD_SIZE \
+                * MICROTAGS_RECORD_SIZE)
+
+/* array used to convert data to base64 */
+static const uint8_t microtags_base64[64] = {
+        'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
+        'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+        'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X',
+        'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
+        'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n',
+        'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
+        'w', 'x', 'y', 'z', '0', '1', '2', '3',
+        '4', '5', '6', '7', '8', '9', '+', '/' };
+
+
+#if defined(MICROTAGS_STREAM)
+
+/*
+ * Function to write a microtag to the ring buffer (as a packed record)
+ * ___________________________________________________________________________
+ */
+static inline void microtags_store(
+        uint_fast32_t data, uint_fast16_t id, uint_fast16_t kind) {
+
+    uint8_t record[MICROTAGS_RECORD_SIZE];
+
+    /* the kind of microtag is not kept in the ring buffer */
+    (void)kind;
+
+    /* data and id in network byte order */
+    record[0] = (uint8_t)(data >> 24);
+    record[1] = (uint8_t)(data >> 16);
+    record[2] = (uint8_t)(data >> 8);
+    record[3] = (uint8_t)data;
+    record[4] = (uint8_t)(id >> 8);
+    record[5] = (uint8_t)id;
+
+    MICROTAGS_LOCK();
+    if (ringbuffer_get_space(&rb_microtags) >= MICROTAGS_RECORD_SIZE) {
+        ringbuffer_write(&rb_microtags, record, MICROTAGS_RECORD_SIZE);
+    } else {
+        ++n_microtags_dropped;
+    }
+    MICROTAGS_UNLOCK();
+}
+
+
+/*
+ * Function to write two microtags to the ring buffer in a single write such
+ * that no other microtag can end up in between (or only one of them)
+ * ___________________________________________________________________________
+ */
+static inline void microtags_store_pair(const microtag_t pair[2]) {
+
+    uint8_t records[2 * MICROTAGS_RECORD_SIZE];
+    uint_fast8_t i;
+
+    for (i = 0; i < 2; ++i) {
+        uint8_t* record = &records[i * MICROTAGS_RECORD_SIZE];
+        record[0] = (uint8_t)(pair[i].data >> 24);
+        record[1] = (uint8_t)(pair[i].data >> 16);
+        record[2] = (uint8_t)(pair[i].data >> 8);
+        record[3] = (uint8_t)pair[i].data;
+        record[4] = (uint8_t)(pair[i].id >> 8);
+        record[5] = (uint8_t)pair[i].id;
+    }
+
+    MICROTAGS_LOCK();
+    if (ringbuffer_get_space(&rb_microtags) >= sizeof(records)) {
+        ringbuffer_write(&rb_microtags, records, sizeof(records));
+    } else {
+        n_microtags_dropped += 2;
+    }
+    MICROTAGS_UNLOCK();
+}
+
+#elif defined(MICROTAGS_ATOMIC)
+
+/*
+ * Function to write a microtag to a slot of the buffer reserved atomically
+ * ___________________________________________________________________________
+ */
+static inline void microtags_store(
+        uint_fast32_t data, uint_fast16_t id, uint_fast16_t kind) {
+
+#ifdef MICROTAGS_INLINE
+
+    microtags_store_inline(data, id, kind);
+
+#else
+
+    /* reserve a slot (the buffer order of tags set from nested contexts
+     * may thus differ slightly from the order of their ticks) */
+    uint_fast32_t i = microtags_atomic_reserve(&n_microtags, 1, MICROTAGS_N_MAX);
+
+    if (i < MICROTAGS_N_MAX) {
+        /* store in memory */
+        buf_microtags[i].data = data;
+        buf_microtags[i].id = id;
+        buf_microtags[i].kind = kind;
+        microtags_atomic_add(&n_microtags_committed, 1);
+    }
+
+#endif
+}
+
+
+/*
+ * Function to write two microtags to two consecutive slots of the buffer
+ * reserved in a single atomic step (or to drop both)
+ * ___________________________________________________________________________
+ */
+static inline void microtags_store_pair(const microtag_t pair[2]) {
+
+    uint_fast32_t i = microtags_atomic_reserve(&n_microtags, 2, MICROTAGS_N_MAX);
+
+    if (i < MICROTAGS_N_MAX) {
+        buf_microtags[i] = pair[0];
+        buf_microtags[i + 1] = pair[1];
+        microtags_atomic_add(&n_microtags_committed, 2);
+    }
+}
+
+
+/*
+ * Function to wait until no writer is in the middle of storing a microtag
+ * and to return the number of microtags in the buffer. Must not be called
+ * from a context that may preempt a writer (e.g. not from an ISR while
+ * the main loop is recording), as it would wait forever in this case.
+ * ___________________________________________________________________________
+ */
+static uint_fast32_t microtags_settle(void) {
+
+    uint_fast32_t n;
+    uint_fast32_t committed;
+
+    /* all of n reserved microtags have been committed only if no slot has
+     * been reserved in between reading both counters (the committed count
+     * never exceeds the reserved one, but a later writer may commit before
+     * an earlier one), so the reserved count is read again afterwards */
+    do {
+        n = microtags_atomic_load(&n_microtags);
+        committed = microtags_atomic_load(&n_microtags_committed);
+    } while (committed != n || microtags_atomic_load(&n_microtags) != n);
+
+    return n;
+}
+
+
+/*
+ * Function to remove the first <n> microtags from the buffer. This only
+ * succeeds (and returns non-zero) if no new microtag has been added since
+ * the buffer has been found to hold <n> microtags.
+ * ___________________________________________________________________________
+ */
+static int microtags_release(uint_fast32_t n) {
+
+    int released = microtags_atomic_cas(&n_microtags, n, 0);
+
+    if (released != 0) {
+        /* writers committing after the reset above are counted on top */
+        microtags_atomic_sub(&n_microtags_committed, n);
+    }
+
+    return released;
+}
+
+#elif defined(MICROTAGS_HOST)
+
+/*
+ * Function to hand over a chunk to the collector
+ * ___________________________________________________________________________
+ */
+static void microtags_host_hand_over(microtags_chunk_t* chunk) {
+
+    chunk->next = atomic_load_explicit(&chunks_handed_over, memory_order_relaxed);
+
+    while (!atomic_compare_exchange_weak_explicit(&chunks_handed_over,
+            &chunk->next, chunk, memory_order_release, memory_order_relaxed)) {
+        /* somebody else handed over a chunk in between, try again */
+    }
+}
+
+
+/*
+ * Function called on termination of a thread with its current chunk
+ * ___________________________________________________________________________
+ */
+static void microtags_host_thread_exit(void* chunk) {
+
+    if (((microtags_chunk_t*)chunk)->n > 0) {
+        microtags_host_hand_over((microtags_chunk_t*)chunk);
+    } else {
+        free(chunk);
+    }
+}
+
+
+/*
+ * Function to create the key used to hand over chunks on thread termination
+ * ___________________________________________________________________________
+ */
+static void microtags_host_key_create(void) {
+
+    pthread_key_create(&key_microtags, &microtags_host_thread_exit);
+}
+
+
+/*
+ * Function to hand over the calling thread's full chunk (if any) and to
+ * start a new one. Returns 0 if no memory is left
+ * ___________________________________________________________________________
+ */
+static microtags_chunk_t* microtags_host_next_chunk(void) {
+
+    microtags_chunk_t* chunk = chunk_microtags;
+
+    if (chunk != 0) {
+        microtags_host_hand_over(chunk);
+    }
+
+    chunk = (microtags_chunk_t*)malloc(sizeof(microtags_chunk_t));
+    if (chunk != 0) {
+        chunk->n = 0;
+        chunk->tid = (uint32_t)syscall(SYS_gettid);
+    }
+
+    pthread_once(&once_microtags, &microtags_host_key_create);
+    pthread_setspecific(key_microtags, chunk);
+    chunk_microtags = chunk;
+
+    return chunk;
+}
+
+
+/*
+ * Function to write a microtag to the calling thread's chunk (no locks or
+ * atomics involved unless the chunk is full)
+ * ___________________________________________________________________________
+ */
+static inline void microtags_store(
+        uint_fast32_t data, uint_fast16_t id, uint_fast16_t kind) {
+
+    microtags_chunk_t* chunk = chunk_microtags;
+
+    if (chunk == 0 || chunk->n == MICROTAGS_HOST_CHUNK_N) {
+        chunk = microtags_host_next_chunk();
+        if (chunk == 0) {
+            /* out of memory, drop microtag */
+            return;
+        }
+    }
+
+    chunk->tags[chunk->n].data = data;
+    chunk->tags[chunk->n].id = id;
+    chunk->tags[chunk->n].kind = kind;
+    ++chunk->n;
+}
+
+
+/*
+ * Function to write two microtags to the same chunk of the calling thread
+ * ___________________________________________________________________________
+ */
+static inline void microtags_store_pair(const microtag_t pair[2]) {
+
+    microtags_chunk_t* chunk = chunk_microtags;
+
+    if (chunk == 0 || chunk->n + 2 > MICROTAGS_HOST_CHUNK_N) {
+        chunk = microtags_host_next_chunk();
+    }
+
+    /* otherwise out of memory, drop microtags */
+    if (chunk != 0) {
+        chunk->tags[chunk->n] = pair[0];
+        chunk->tags[chunk->n + 1] = pair[1];
+        chunk->n += 2;
+    }
+}
+
+
+/*
+ * Function to hand over the calling thread's microtags to the collector
+ * ___________________________________________________________________________
+ */
+void microtags_host_thread_flush(void) {
+
+    microtags_chunk_t* chunk = chunk_microtags;
+
+    if (chunk != 0 && chunk->n > 0) {
+        microtags_host_hand_over(chunk);
+        chunk_microtags = 0;
+        pthread_setspecific(key_microtags, 0);
+    }
+}
+
+
+/*
+ * Function to take over all chunks handed over so far and to return the
+ * number of microtags (including thread markers) collected
+ * ___________________________________________________________________________
+ */
+static uint_fast32_t microtags_settle(void) {
+
+    microtags_chunk_t* chunks;
+    microtags_chunk_t* chunk;
+    microtags_chunk_t* reversed = 0;
+
+    /* the collecting thread's own microtags */
+    microtags_host_thread_flush();
+
+    chunks = atomic_exchange_explicit(
+            &chunks_handed_over, 0, memory_order_acquire);
+
+    /* restore the order of hand-over */
+    while (chunks != 0) {
+        chunk = chunks;
+        chunks = chunk->next;
+        chunk->next = reversed;
+        reversed = chunk;
+    }
+
+    if (chunk_loaded == 0) {
+        chunk_loaded = reversed;
+        pos_loaded = 0;
+    }
+
+    /* append to the chunks collected before */
+    for (chunk = reversed; chunk != 0; chunk = chunk->next) {
+        if (chunks_collected_last != 0) {
+            chunks_collected_last->next = chunk;
+        } else {
+            chunks_collected = chunk;
+        }
+        chunks_collected_last = chunk;
+        n_microtags += chunk->n + 1;
+    }
+
+    return n_microtags;
+}
+
+
+/*
+ * Function to release all collected chunks
+ * ___________________________________________________________________________
+ */
+static int microtags_release(uint_fast32_t n) {
+
+    microtags_chunk_t* chunk;
+
+    (void)n;
+
+    while (chunks_collected != 0) {
+        chunk = chunks_collected;
+        chunks_collected = chunk->next;
+        free(chunk);
+    }
+
+    chunks_collected_last = 0;
+    chunk_loaded = 0;
+    pos_loaded = 0;
+    n_microtags = 0;
+
+    return 1;
+}
+
+
+/*
+ * Function to load the next collected microtag. Each chunk is preceded by
+ * a thread marker (a data-based microtag with id MICROTAGS_ID_THREAD
+ * carrying the id of the thread that recorded the chunk)
+ * ___________________________________________________________________________
+ */
+static inline void microtags_load(uint_fast32_t* i, uint_fast32_t* ticks,
+        microtag_t* tag) {
+
+    (void)ticks;
+
+    if (pos_loaded == 0) {
+        tag->data = chunk_loaded->tid;
+        tag->id = MICROTAGS_ID_THREAD;
+        tag->kind = MICROTAGS_KIND_DATA;
+    } else {
+        *tag = chunk_loaded->tags[pos_loaded - 1];
+    }
+
+    if (pos_loaded++ == chunk_loaded->n) {
+        chunk_loaded = chunk_loaded->next;
+        pos_loaded = 0;
+    }
+
+    ++(*i);
+}
+
+
+#elif defined(MICROTAGS_COMPACT)
+
+/*
+ * Function to write a microtag to one or two slots of the buffer
+ * ___________________________________________________________________________
+ */
+static inline void microtags_store(
+        uint_fast32_t data, uint_fast16_t id, uint_fast16_t kind) {
+
+    uint_fast32_t delta = (data - ticks_microtags) & 0xFFFFFFFF;
+
+    if (kind == MICROTAGS_KIND_TICKS && ticks_microtags_valid != 0
+            && delta < MICROTAGS_COMPACT_DATA) {
+
+        /* a single slot is enough */
+        if (n_microtags < MICROTAGS_N_SLOTS) {
+            buf_microtags[n_microtags++] = ((uint32_t)id << 16) | delta;
+            ticks_microtags = data;
+        }
+
+    } else if (n_microtags + 1 < MICROTAGS_N_SLOTS) {
+
+        /* slot announcing the extension slot holding the full value */
+        buf_microtags[n_microtags++] = ((uint32_t)id << 16)
+                | ((kind == MICROTAGS_KIND_TICKS)
+                        ? MICROTAGS_COMPACT_TICKS : MICROTAGS_COMPACT_DATA);
+        buf_microtags[n_microtags++] = data;
+
+        if (kind == MICROTAGS_KIND_TICKS) {
+            ticks_microtags = data;
+            ticks_microtags_valid = 1;
+        }
+    }
+}
+
+
+/*
+ * Function to write two microtags to the buffer, either both or none of
+ * them (each takes at most two slots)
+ * ___________________________________________________________________________
+ */
+static inline void microtags_store_pair(const microtag_t pair[2]) {
+
+    if (n_microtags + 4 <= MICROTAGS_N_SLOTS) {
+        microtags_store(pair[0].data, pair[0].id, pair[0].kind);
+        microtags_store(pair[1].data, pair[1].id, pair[1].kind);
+    }
+}
+
+
+/*
+ * Function to return the number of used slots in the buffer
+ * ___________________________________________________________________________
+ */
+static uint_fast32_t microtags_settle(void) {
+
+    return n_microtags;
+}
+
+
+/*
+ * Function to remove the first <n> slots from the buffer
+ * ___________________________________________________________________________
+ */
+static int microtags_release(uint_fast32_t n) {
+
+    (void)n;
+    n_microtags = 0;
+    ticks_microtags_valid = 0;
+
+    return 1;
+}
+
+
+/*
+ * Function to load the microtag starting at slot <*i> of the buffer and to
+ * advance <*i> to the next microtag. <*ticks> holds the ticks of the
+ * previously loaded ticks-based microtag
+ * ___________________________________________________________________________
+ */
+static inline void microtags_load(uint_fast32_t* i, uint_fast32_t* ticks,
+        microtag_t* tag) {
+
+    uint32_t slot = buf_microtags[(*i)++];
+
+    tag->id = (uint16_t)(slot >> 16);
+    slot &= 0x0000FFFF;
+
+    if (slot == MICROTAGS_COMPACT_DATA) {
+        tag->kind = MICROTAGS_KIND_DATA;
+        tag->data = buf_microtags[(*i)++];
+    } else {
+        tag->kind = MICROTAGS_KIND_TICKS;
+        if (slot == MICROTAGS_COMPACT_TICKS) {
+            *ticks = buf_microtags[(*i)++];
+        } else {
+            *ticks = (*ticks + slot) & 0xFFFFFFFF;
+        }
+        tag->data = *ticks;
+    }
+}
+
+#else
+
+/*
+ * Function to write a microtag to the buffer
+ * ___________________________________________________________________________
+ */
+static inline void microtags_store(
+        uint_fast32_t data, uint_fast16_t id, uint_fast16_t kind) {
+
+#ifdef MICROTAGS_INLINE
+
+    microtags_store_inline(data, id, kind);
+
+#else
+
+	/* store in memory */
+	buf_microtags[n_microtags].data = data;
+	buf_microtags[n_microtags].kind = kind;
+	buf_microtags[n_microtags++].id = id;
+
 #endif
+}
 
-#ifndef MICROTAGS_GET_TICKS
 
-    #define MICROTAGS_GET_TICKS() microtags_get_ticks()
+/*
+ * Function to write two microtags to the buffer, either both or none of them
+ * ___________________________________________________________________________
+ */
+static inline void microtags_store_pair(const microtag_t pair[2]) {
 
-    /* externally defined function to return current tick counter */
-    extern uint32_t microtags_get_ticks(void);
+    if (n_microtags + 2 <= MICROTAGS_N_MAX) {
+        buf_microtags[n_microtags] = pair[0];
+        buf_microtags[n_microtags + 1] = pair[1];
+        n_microtags += 2;
+    }
+}
+
+
+/*
+ * Function to return the number of microtags in the buffer
+ * ___________________________________________________________________________
+ */
+static uint_fast32_t microtags_settle(void) {
+
+    return n_microtags;
+}
+
+
+/*
+ * Function to remove the first <n> microtags from the buffer
+ * ___________________________________________________________________________
+ */
+static int microtags_release(uint_fast32_t n) {
+
+    (void)n;
+    n_microtags = 0;
+
+    return 1;
+}
+
+#endif
+
+
+#if !defined(MICROTAGS_STREAM) && !defined(MICROTAGS_COMPACT) \
+        && !defined(MICROTAGS_HOST)
+
+/*
+ * Function to load the microtag <*i> from the buffer and to advance <*i>
+ * ___________________________________________________________________________
+ */
+static inline void microtags_load(uint_fast32_t* i, uint_fast32_t* ticks,
+        microtag_t* tag) {
+
+    (void)ticks;
+    *tag = buf_microtags[(*i)++];
+}
 
 #endif
 
 
-/* the counter to hold the current number of microtags in the buffer */
-static uint_fast16_t n_microtags = 0;
+#if defined(MICROTAGS_HOST_EPOCH)
 
-/* the buffer to hold microtags between being set and being sent out */
-static microtag_t buf_microtags[MICROTAGS_N_MAX];
+/* the upper 32 bits of the thread's ticks as of its last epoch marker */
+static _Thread_local uint32_t epoch_high = 0;
+
+#elif defined(MICROTAGS_HOST)
+
+/* the upper 32 bits of the thread's 64-bit ticks (i.e. the number of
+ * wrap-arounds of the tick counter) and the ticks seen by the thread's last
+ * call to microtags_set_epoch() */
+static _Thread_local uint32_t epoch_high = 0;
+static _Thread_local uint32_t epoch_last = 0;
+
+#else
+
+/* the upper 32 bits of the 64-bit ticks (i.e. the number of wrap-arounds of
+ * the tick counter) and the ticks seen by the last microtags_set_epoch() */
+static uint32_t epoch_high = 0;
+static uint32_t epoch_last = 0;
+
+#endif
+
+
+/*
+ * Function to write an epoch marker for the 64-bit ticks <high>:<ticks>
+ * (both microtags in one step, as the decoder expects them back to back)
+ * ___________________________________________________________________________
+ */
+static inline void microtags_store_epoch(uint32_t high, uint32_t ticks) {
+
+    microtag_t pair[2];
+
+    pair[0].data = high;
+    pair[0].id = MICROTAGS_ID_EPOCH;
+    pair[0].kind = MICROTAGS_KIND_DATA;
+    pair[1].data = ticks;
+    pair[1].id = MICROTAGS_ID_EPOCH_TICKS;
+    pair[1].kind = MICROTAGS_KIND_TICKS;
+
+    microtags_store_pair(pair);
+}
 
 
 /*
@@ -51,9 +895,23 @@ static microtag_t buf_microtags[MICROTAGS_N_MAX];
  */
 void microtags_set_ticks(uint_fast16_t id) {
 
-	/* store in memory */
-	buf_microtags[n_microtags].data = MICROTAGS_GET_TICKS();
-	buf_microtags[n_microtags++].id = id;
+#ifdef MICROTAGS_HOST_EPOCH
+
+    uint64_t ticks = microtags_host_ticks();
+
+    /* the lower 32 bits wrapped around since the last marker */
+    if ((uint32_t)(ticks >> 32) != epoch_high) {
+        epoch_high = (uint32_t)(ticks >> 32);
+        microtags_store_epoch(epoch_high, (uint32_t)ticks);
+    }
+
+    microtags_store((uint32_t)ticks, id, MICROTAGS_KIND_TICKS);
+
+#else
+
+    microtags_store(MICROTAGS_GET_TICKS(), id, MICROTAGS_KIND_TICKS);
+
+#endif
 }
 
 
@@ -63,11 +921,196 @@ void microtags_set_ticks(uint_fast16_t id) {
  */
 void microtags_set_data(uint_fast16_t id, uint_fast32_t data) {
 
-	/* store in memory */
-	buf_microtags[n_microtags].data = data;
-	buf_microtags[n_microtags++].id = id;
+    microtags_store(data, id, MICROTAGS_KIND_DATA);
+}
+
+
+/*
+ * Function to set an epoch marker
+ * ___________________________________________________________________________
+ */
+void microtags_set_epoch(void) {
+
+#ifdef MICROTAGS_HOST_EPOCH
+
+    uint64_t ticks = microtags_host_ticks();
+
+    epoch_high = (uint32_t)(ticks >> 32);
+    microtags_store_epoch(epoch_high, (uint32_t)ticks);
+
+#else
+
+    uint32_t ticks = MICROTAGS_GET_TICKS();
+
+    /* the tick counter wrapped around since the last call */
+    if (ticks < epoch_last) {
+        ++epoch_high;
+    }
+    epoch_last = ticks;
+
+    microtags_store_epoch(epoch_high, ticks);
+
+#endif
+}
+
+
+/*
+ * Function to encode a single microtag as a line of base64 text
+ * ___________________________________________________________________________
+ */
+static void microtags_encode_text(
+        uint8_t* line, uint_fast32_t data, uint_fast32_t id) {
+
+    /* most-significant bits of data ... */
+    line[0] = microtags_base64[(data & 0xFC000000) >> 26];
+    line[1] = microtags_base64[(data & (0xFC000000 >> 6)) >> 20];
+    line[2] = microtags_base64[(data & (0xFC000000 >> 12)) >> 14];
+    line[3] = microtags_base64[(data & (0xFC000000 >> 18)) >> 8];
+    line[4] = microtags_base64[(data & (0xFC000000 >> 24)) >> 2];
+    line[5] = microtags_base64[
+        /* ... least-significant bits of data */
+        ((data & (0xFC000000 >> 30)) << 4)
+        /* most-significant bits of ID ... */
+        | ((id & 0x0000F000) >> 12)];
+    line[6] = microtags_base64[(id & 0x00000FC0) >> 6];
+    /* ... least-significant bits of ID */
+    line[7] = microtags_base64[id & 0x0000003F];
+
+    /* newline */
+    line[8] = '\r';
+    line[9] = '\n';
+}
+
+
+/*
+ * Function to complete the header of the block in the staging buffer and
+ * to send out the block
+ * ___________________________________________________________________________
+ */
+static void microtags_emit_block(microtags_send_block_t microtags_send_block,
+        uint_fast8_t format, size_t len) {
+
+    buf_block[0] = MICROTAGS_BLOCK_SYNC;
+    buf_block[1] = (uint8_t)format;
+    buf_block[2] = (uint8_t)(len >> 8);
+    buf_block[3] = (uint8_t)len;
+
+    (*microtags_send_block)(buf_block, MICROTAGS_BLOCK_HEADER_SIZE + len);
+}
+
+
+#if defined(MICROTAGS_STREAM)
+
+/*
+ * Function to send out up to <max_bytes> bytes of pending microtags
+ * ___________________________________________________________________________
+ */
+size_t microtags_pump(microtags_send_byte_t microtags_send_byte,
+        size_t max_bytes) {
+
+    uint8_t record[MICROTAGS_RECORD_SIZE];
+    size_t  n = 0;
+    size_t  len;
+
+    if (microtags_send_byte != 0) {
+
+        while (n < max_bytes) {
+
+            if (n_line_sent == MICROTAGS_TEXT_SIZE) {
+
+                /* current line is done, fetch next microtag */
+                MICROTAGS_LOCK();
+                len = ringbuffer_read(
+                        &rb_microtags, record, MICROTAGS_RECORD_SIZE);
+                MICROTAGS_UNLOCK();
+
+                if (len != MICROTAGS_RECORD_SIZE) {
+                    /* nothing left to send */
+                    break;
+                }
+
+                microtags_encode_text(line_microtags,
+                        ((uint_fast32_t)record[0] << 24)
+                        | ((uint_fast32_t)record[1] << 16)
+                        | ((uint_fast32_t)record[2] << 8)
+                        | (uint_fast32_t)record[3],
+                        ((uint_fast32_t)record[4] << 8)
+                        | (uint_fast32_t)record[5]);
+                n_line_sent = 0;
+            }
+
+            (*microtags_send_byte)(line_microtags[n_line_sent++]);
+            ++n;
+        }
+    }
+
+    return n;
+}
+
+
+/*
+ * Function to return the number of microtags dropped so far due to a full
+ * ring buffer
+ * ___________________________________________________________________________
+ */
+uint32_t microtags_get_dropped(void) {
+
+    return n_microtags_dropped;
+}
+
+
+/*
+ * Function to send out all microtags from the buffer and clear the buffer
+ * ___________________________________________________________________________
+ */
+void microtags_flush_text(microtags_send_byte_t microtags_send_byte) {
+
+    microtags_pump(microtags_send_byte, (size_t)-1);
+}
+
+
+/*
+ * Function to send out all microtags from the buffer as binary blocks and
+ * clear the buffer
+ * ___________________________________________________________________________
+ */
+void microtags_flush_binary(microtags_send_block_t microtags_send_block) {
+
+    size_t len;
+
+    if (microtags_send_block != 0) {
+
+        do {
+            /* the ring buffer already holds packed records */
+            MICROTAGS_LOCK();
+            len = ringbuffer_read(&rb_microtags,
+                    buf_block + MICROTAGS_BLOCK_HEADER_SIZE,
+                    MICROTAGS_BLOCK_PAYLOAD_MAX);
+            MICROTAGS_UNLOCK();
+
+            if (len > 0) {
+                microtags_emit_block(microtags_send_block,
+                        MICROTAGS_BLOCK_PACKED, len);
+            }
+
+        } while (len == MICROTAGS_BLOCK_PAYLOAD_MAX);
+    }
+}
+
+
+/*
+ * Function to clear the buffer
+ * ___________________________________________________________________________
+ */
+void microtags_clear(void) {
+
+    MICROTAGS_LOCK();
+    ringbuffer_clear(&rb_microtags);
+    n_line_sent = MICROTAGS_TEXT_SIZE;
+    MICROTAGS_UNLOCK();
 }
 
+#else
 
 /*
  * Function to send out all microtags from the buffer and clear the buffer
@@ -75,68 +1118,260 @@ void microtags_set_data(uint_fast16_t id, uint_fast32_t data) {
  */
 void microtags_flush_text(microtags_send_byte_t microtags_send_byte) {
 
-    /* array used to convert data to base64 */
-	static const uint8_t microtags_base64[64] = {
-			'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
-            'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
-            'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X',
-            'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
-            'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n',
-            'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
-            'w', 'x', 'y', 'z', '0', '1', '2', '3',
-            '4', '5', '6', '7', '8', '9', '+', '/' };
+	uint8_t         line[MICROTAGS_TEXT_SIZE];
+	microtag_t      tag;
+	uint_fast32_t	n;
+	uint_fast32_t	i = 0;
+	uint_fast32_t	ticks = 0;
+	uint_fast8_t	j;
+
+    if (microtags_send_byte != 0) {
+
+        /* repeat as long as new microtags keep arriving while flushing */
+        do {
+            n = microtags_settle();
+
+            /* iterate over all (remaining) microtags in the buffer */
+	        while (i < n) {
+
+                microtags_load(&i, &ticks, &tag);
+                microtags_encode_text(line, tag.data, tag.id);
+
+                for (j = 0; j < MICROTAGS_TEXT_SIZE; ++j) {
+                    (*microtags_send_byte)(line[j]);
+                }
+	        }
+
+        /* clear the buffer */
+        } while (!microtags_release(n));
+    }
+}
+
+
+/*
+ * Function to append an unsigned LEB128 varint to a buffer. Returns the
+ * number of bytes appended (at most 5)
+ * ___________________________________________________________________________
+ */
+static size_t microtags_put_varint(uint8_t* buf, uint_fast32_t value) {
+
+    size_t n = 0;
+
+    while (value >= 0x80) {
+        buf[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buf[n++] = (uint8_t)value;
+
+    return n;
+}
+
 
+/*
+ * Function to send out all microtags from the buffer as binary blocks of
+ * the given format and clear the buffer
+ * ___________________________________________________________________________
+ */
+static void microtags_flush_blocks(
+        microtags_send_block_t microtags_send_block, uint_fast8_t format) {
+
+	uint8_t*        record;
+	microtag_t      tag;
 	uint_fast32_t	data;
+	uint_fast32_t	delta;
 	uint_fast32_t	id;
-	uint_fast16_t	i;
+	uint_fast32_t	n;
+	uint_fast32_t	i = 0;
+	size_t          len = 0;
 
-    if (microtags_send_byte != 0) {
+    /* the block is sent out once it cannot take another microtag */
+    size_t          len_max = (format == MICROTAGS_BLOCK_PACKED)
+            ? (MICROTAGS_BLOCK_PAYLOAD_MAX - MICROTAGS_RECORD_SIZE)
+            : (MICROTAGS_BLOCK_SIZE - MICROTAGS_BLOCK_HEADER_SIZE
+                    - MICROTAGS_VARINT_MAX);
+
+    /* the ticks of the previous ticks-based microtag (delta format) */
+    uint_fast32_t   ticks = 0;
+
+    /* the ticks of the previously loaded ticks-based microtag */
+    uint_fast32_t   ticks_loaded = 0;
+
+    /* the number of ticks-based microtags since the last keyframe */
+    uint_fast32_t   n_keyframe = MICROTAGS_KEYFRAME_INTERVAL;
 
-        /* iterate over all microtags in the buffer */
-	    for (i = 0; i < n_microtags; ++i) {
-
-            data = buf_microtags[i].data;
-            id = buf_microtags[i].id;
-
-            (*microtags_send_byte)(microtags_base64[
-                /* most-significant bits of data ... */
-                (data & 0xFC000000) >> 26]); 
-            (*microtags_send_byte)(microtags_base64[
-                (data & (0xFC000000 >> 6)) >> 20]); 
-            (*microtags_send_byte)(microtags_base64[
-                (data & (0xFC000000 >> 12)) >> 14]); 
-            (*microtags_send_byte)(microtags_base64[
-                (data & (0xFC000000 >> 18)) >> 8]); 
-            (*microtags_send_byte)(microtags_base64[
-                (data & (0xFC000000 >> 24)) >> 2]);
-            (*microtags_send_byte)(microtags_base64[
-                /* ... least-significant bits of data */
-                ((data & (0xFC000000 >> 30)) << 4)
-                /* most-significant bits of ID ... */
-                | ((id & 0x0000F000) >> 12)]); 
-            (*microtags_send_byte)(microtags_base64[
-                (id & 0x00000FC0 >> 0) >> 6]); 
-            (*microtags_send_byte)(microtags_base64[
-                /* ... least-significant bits of ID */
-                id & 0x00000FC0 >> 6]); 
-
-            /* send out newline */
-		    (*microtags_send_byte)('\r');
-		    (*microtags_send_byte)('\n');
-	    }
+    if (microtags_send_block != 0) {
+
+        /* repeat as long as new microtags keep arriving while flushing */
+        do {
+            n = microtags_settle();
+
+            /* iterate over all (remaining) microtags in the buffer */
+	        while (i < n) {
+
+                microtags_load(&i, &ticks_loaded, &tag);
+                data = tag.data;
+                id = tag.id;
+                record = buf_block + MICROTAGS_BLOCK_HEADER_SIZE + len;
+
+                if (format == MICROTAGS_BLOCK_PACKED) {
+
+                    /* pack microtag into block (network byte order) */
+                    record[0] = (uint8_t)(data >> 24);
+                    record[1] = (uint8_t)(data >> 16);
+                    record[2] = (uint8_t)(data >> 8);
+                    record[3] = (uint8_t)data;
+                    record[4] = (uint8_t)(id >> 8);
+                    record[5] = (uint8_t)id;
+                    len += MICROTAGS_RECORD_SIZE;
+
+                } else if (tag.kind == MICROTAGS_KIND_DATA) {
+
+                    len += microtags_put_varint(record,
+                            (id << 2) | MICROTAGS_DELTA_DATA);
+                    len += microtags_put_varint(
+                            buf_block + MICROTAGS_BLOCK_HEADER_SIZE + len, data);
+
+                } else if (n_keyframe >= MICROTAGS_KEYFRAME_INTERVAL) {
+
+                    /* absolute ticks to allow a decoder to resync */
+                    len += microtags_put_varint(record,
+                            (id << 2) | MICROTAGS_DELTA_KEYFRAME);
+                    len += microtags_put_varint(
+                            buf_block + MICROTAGS_BLOCK_HEADER_SIZE + len, data);
+                    ticks = data;
+                    n_keyframe = 1;
+
+                } else {
+
+                    /* zig-zag encoded (signed 32-bit) difference of ticks */
+                    delta = (data - ticks) & 0xFFFFFFFF;
+                    delta = ((delta << 1) ^ (0 - (delta >> 31))) & 0xFFFFFFFF;
+                    len += microtags_put_varint(record,
+                            (id << 2) | MICROTAGS_DELTA_TICKS);
+                    len += microtags_put_varint(
+                            buf_block + MICROTAGS_BLOCK_HEADER_SIZE + len, delta);
+                    ticks = data;
+                    ++n_keyframe;
+                }
+
+                if (len > len_max) {
+                    microtags_emit_block(microtags_send_block, format, len);
+                    len = 0;
+                    /* each block starts with a keyframe */
+                    n_keyframe = MICROTAGS_KEYFRAME_INTERVAL;
+                }
+	        }
 
         /* clear the buffer */
-	    microtags_clear();
+        } while (!microtags_release(n));
+
+        /* send out remaining partial block */
+        if (len > 0) {
+            microtags_emit_block(microtags_send_block, format, len);
+        }
     }
 }
 
 
+/*
+ * Function to send out all microtags from the buffer as binary blocks and
+ * clear the buffer
+ * ___________________________________________________________________________
+ */
+void microtags_flush_binary(microtags_send_block_t microtags_send_block) {
+
+    microtags_flush_blocks(microtags_send_block, MICROTAGS_BLOCK_PACKED);
+}
+
+
+/*
+ * Function to send out all microtags from the buffer as delta/varint coded
+ * binary blocks and clear the buffer
+ * ___________________________________________________________________________
+ */
+void microtags_flush_delta(microtags_send_block_t microtags_send_block) {
+
+    microtags_flush_blocks(microtags_send_block, MICROTAGS_BLOCK_DELTA);
+}
+
+
 /*
  * Function to clear the buffer
  * ___________________________________________________________________________
  */
 void microtags_clear(void) {
 
-    n_microtags = 0;
+    while (!microtags_release(microtags_settle())) {
+        /* new microtags arrived in between, try again */
+    }
+}
+
+#endif
+
+#ifdef MICROTAGS_HOST
+
+/* the state of the collector thread */
+static pthread_t collector_thread;
+static atomic_int collector_running = 0;
+static microtags_send_block_t collector_send_block = 0;
+static struct timespec collector_period;
+
+
+/*
+ * Function run by the collector thread to periodically send out all
+ * microtags handed over so far
+ * ___________________________________________________________________________
+ */
+static void* microtags_host_collector(void* arg) {
+
+    (void)arg;
+
+    while (atomic_load(&collector_running) != 0) {
+        nanosleep(&collector_period, 0);
+        microtags_flush_binary(collector_send_block);
+    }
+
+    return 0;
+}
+
+
+/*
+ * Function to start the collector thread sending out microtags as binary
+ * blocks every <period_ms> milliseconds. Returns 0 on success
+ * ___________________________________________________________________________
+ */
+int microtags_host_collector_start(
+        microtags_send_block_t microtags_send_block, uint32_t period_ms) {
+
+    if (atomic_exchange(&collector_running, 1) != 0) {
+        /* already running */
+        return -1;
+    }
+
+    collector_send_block = microtags_send_block;
+    collector_period.tv_sec = period_ms / 1000;
+    collector_period.tv_nsec = (long)(period_ms % 1000) * 1000000;
+
+    if (pthread_create(&collector_thread, 0, &microtags_host_collector, 0) != 0) {
+        atomic_store(&collector_running, 0);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Function to stop the collector thread after sending out the remaining
+ * microtags handed over so far
+ * ___________________________________________________________________________
+ */
+void microtags_host_collector_stop(void) {
+
+    if (atomic_exchange(&collector_running, 0) != 0) {
+        pthread_join(collector_thread, 0);
+        microtags_flush_binary(collector_send_block);
+    }
 }
 
+#endif
@@ -26,6 +26,161 @@
 #define MICROTAGS_H_
 
 #include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Compile-time options (to be defined when compiling microtags.c):
+ *
+ *  MICROTAGS_N_MAX      size of the microtags buffer (default: 128)
+ *  MICROTAGS_GET_TICKS  expression returning the current tick counter
+ *                       (default: call to external microtags_get_ticks())
+ *  MICROTAGS_ATOMIC     reserve buffer slots using a lock-free atomic
+ *                       fetch-add (see microtags_atomic.h) such that
+ *                       microtags can be set from ISRs and the main loop
+ *                       concurrently without disabling interrupts. The
+ *                       flush/clear functions must then not be called
+ *                       from a context preempting a recording.
+ *  MICROTAGS_STREAM     record microtags into a ring buffer (see
+ *                       ringbuffers/ringbuffer.h) of MICROTAGS_STREAM_SIZE
+ *                       bytes (default: MICROTAGS_N_MAX records, rounded
+ *                       up to a power of two with RINGBUFFER_POW2) that is
+ *                       drained in the background by microtags_pump().
+ *                       If microtags are set from a context preempting
+ *                       microtags_pump() (or vice versa), MICROTAGS_LOCK()
+ *                       and MICROTAGS_UNLOCK() have to be defined to guard
+ *                       the (short) ring buffer accesses.
+ *  MICROTAGS_COMPACT    store microtags in 4-byte slots holding the id and
+ *                       a 16-bit difference of ticks, followed by a 4-byte
+ *                       extension slot only if the difference does not fit
+ *                       or for data-based microtags. MICROTAGS_N_SLOTS
+ *                       (default: same memory as MICROTAGS_N_MAX microtags
+ *                       in the default layout) sets the number of slots.
+ *                       Cannot be combined with ATOMIC or STREAM.
+ *  MICROTAGS_INLINE     share the buffer with the header-only fast path in
+ *                       microtags_inline.h and use the CPU's cycle counter
+ *                       as tick source (unless MICROTAGS_GET_TICKS is set)
+ *  MICROTAGS_HOST       record microtags on a (Linux) host into per-thread
+ *                       chunks of MICROTAGS_HOST_CHUNK_N microtags (default:
+ *                       4096) without any locks or atomics on the hot path.
+ *                       Full chunks (and those of terminated threads) are
+ *                       handed over to the thread flushing the microtags,
+ *                       e.g. the one started by
+ *                       microtags_host_collector_start(). When flushed,
+ *                       each chunk is preceded by a MICROTAGS_ID_THREAD
+ *                       microtag. Ticks default to CLOCK_MONOTONIC_RAW in
+ *                       ns. Cannot be combined with other buffer modes.
+ *                       See microtags_mmap.h for a trace file sink.
+ *  MICROTAGS_BLOCK_SIZE size of the staging buffer used to hand out blocks
+ *                       in microtags_flush_binary() (default: header and
+ *                       32 packed records)
+ */
+
+#ifndef MICROTAGS_N_MAX
+    #define MICROTAGS_N_MAX 128
+#endif
+
+/* the size of a packed microtag (32-bit data and 16-bit id) */
+#define MICROTAGS_RECORD_SIZE 6
+
+/* the size of a microtag as line of text (8 base64 characters + CR/LF) */
+#define MICROTAGS_TEXT_SIZE 10
+
+/*
+ * Binary blocks (see microtags_flush_binary()) start with a 4-byte header:
+ *
+ *  [0]    sync byte MICROTAGS_BLOCK_SYNC
+ *  [1]    block format, e.g. MICROTAGS_BLOCK_PACKED
+ *  [2..3] length of the payload following the header (big-endian)
+ *
+ * The payload of a MICROTAGS_BLOCK_PACKED block is a sequence of packed
+ * microtags, each consisting of 32-bit data and 16-bit id (big-endian).
+ */
+#define MICROTAGS_BLOCK_SYNC        0xB5
+#define MICROTAGS_BLOCK_PACKED      0x01
+#define MICROTAGS_BLOCK_DELTA       0x02
+#define MICROTAGS_BLOCK_HEADER_SIZE 4
+
+/*
+ * The payload of a MICROTAGS_BLOCK_DELTA block is a sequence of microtags,
+ * each consisting of two unsigned LEB128 varints. The first one holds the
+ * id shifted left by two bits and one of the types below, the second one
+ * holds the value depending on the type:
+ *
+ *  MICROTAGS_DELTA_TICKS     zig-zag coded difference of ticks to the
+ *                            previous ticks-based microtag (modulo 2^32)
+ *  MICROTAGS_DELTA_KEYFRAME  absolute ticks of a ticks-based microtag
+ *  MICROTAGS_DELTA_DATA      data of a data-based microtag
+ *
+ * Every block starts with a keyframe and keyframes are repeated every
+ * MICROTAGS_KEYFRAME_INTERVAL ticks-based microtags (default: 64).
+ */
+#define MICROTAGS_DELTA_TICKS       0
+#define MICROTAGS_DELTA_KEYFRAME    1
+#define MICROTAGS_DELTA_DATA        2
+
+/* the maximum size of a delta/varint coded microtag (3 + 5 bytes) */
+#define MICROTAGS_VARINT_MAX        8
+
+/* the kinds of microtags */
+#define MICROTAGS_KIND_TICKS        0
+#define MICROTAGS_KIND_DATA         1
+
+/*
+ * Microtag ids may encode a category and a level:
+ *
+ *  bits 15..12  category (0 .. 15), e.g. one per subsystem
+ *  bits 11..10  level (0: essential ... 3: verbose)
+ *  bits  9..0   number of the microtag within its category
+ *
+ * MICROTAGS_SET_TICKS() and MICROTAGS_SET_DATA() only set microtags whose
+ * category is enabled in MICROTAGS_CATEGORY_MASK (default: all) and whose
+ * level does not exceed MICROTAGS_LEVEL_MAX (default: 3). Both are to be
+ * defined when compiling the instrumented code. For constant ids the check
+ * is evaluated at compile time, such that disabled microtags (including
+ * the evaluation of their data argument) vanish completely. The check can
+ * also be used in preprocessor conditionals, i.e. #if MICROTAGS_ENABLED(id)
+ */
+#define MICROTAGS_ID(category, level, number) \
+        ((((category) & 0xF) << 12) | (((level) & 0x3) << 10) \
+                | ((number) & 0x3FF))
+
+#define MICROTAGS_CATEGORY(id)      (((id) >> 12) & 0xF)
+
+#define MICROTAGS_LEVEL(id)         (((id) >> 10) & 0x3)
+
+#ifndef MICROTAGS_CATEGORY_MASK
+    #define MICROTAGS_CATEGORY_MASK 0xFFFF
+#endif
+
+#ifndef MICROTAGS_LEVEL_MAX
+    #define MICROTAGS_LEVEL_MAX     3
+#endif
+
+#define MICROTAGS_ENABLED(id) \
+        ((((MICROTAGS_CATEGORY_MASK) >> MICROTAGS_CATEGORY(id)) & 1) != 0 \
+                && MICROTAGS_LEVEL(id) <= (MICROTAGS_LEVEL_MAX))
+
+/*
+ * Epoch markers extend the 32-bit ticks to a 64-bit timeline (the tick
+ * counter wraps around every 2^32 ticks, e.g. after 51 s at 84 MHz). A
+ * marker is a pair of microtags taken from the same 64-bit tick count: a
+ * data-based one with id MICROTAGS_ID_EPOCH carrying the upper 32 bits,
+ * followed by a ticks-based one with id MICROTAGS_ID_EPOCH_TICKS carrying
+ * the lower 32 bits. Between markers, decoders assume that ticks-based
+ * microtags of the same thread are less than 2^32 ticks apart.
+ */
+
+/* reserved ids (at the top of category 15) */
+#define MICROTAGS_ID_EPOCH_TICKS        0xFFFB
+#define MICROTAGS_ID_EPOCH              0xFFFC
+#define MICROTAGS_ID_THREAD             0xFFFD
+#define MICROTAGS_ID_CALIBRATION_BEGIN  0xFFFE
+#define MICROTAGS_ID_CALIBRATION_END    0xFFFF
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 
 /* definition of a single microtag */
@@ -37,26 +192,106 @@ typedef struct {
     /* 16-bit id of the microtag */
     uint16_t id;
 
+    /* kind of the microtag (MICROTAGS_KIND_TICKS or MICROTAGS_KIND_DATA) */
+    uint16_t kind;
+
 } microtag_t;
 
 /* definition of function pointer to send out a single byte */
 typedef void (*microtags_send_byte_t)(uint8_t byte);
 
+/* definition of function pointer to send out a block of bytes (the block
+ * is only valid until the function returns) */
+typedef void (*microtags_send_block_t)(const uint8_t* block, size_t len);
+
 /* Function to set a ticks-based microtag, i.e. write a microtag to the buffer */
 void microtags_set_ticks(uint_fast16_t id);
 
-#define MICROTAGS_SET_TICKS(id) microtags_set_ticks(id)
+#define MICROTAGS_SET_TICKS(id) do { \
+        if (MICROTAGS_ENABLED(id)) { microtags_set_ticks(id); } } while (0)
 
 /* Function to set a data-based microtag, i.e. write a microtag to the buffer */
 void microtags_set_data(uint_fast16_t id, uint_fast32_t data);
 
-#define MICROTAGS_SET_DATA(id, data) microtags_set_data(id, data)
+#define MICROTAGS_SET_DATA(id, data) do { \
+        if (MICROTAGS_ENABLED(id)) { microtags_set_data(id, data); } } while (0)
+
+/* Function to set an epoch marker (see above), to be called periodically,
+ * at least once per wrap-around of the tick counter (e.g. every 10 s at
+ * 84 MHz), as it also counts the wrap-arounds to extend the ticks to 64
+ * bits. Must not preempt itself. With MICROTAGS_HOST and the default
+ * ticks, markers are also set automatically whenever the upper 32 bits of
+ * a thread's ticks change */
+void microtags_set_epoch(void);
 
 /* Function to send out all microtags from the buffer and clear the buffer */
 void microtags_flush_text(microtags_send_byte_t microtags_send_byte);
 
+/* Function to send out all microtags from the buffer as binary blocks and
+ * clear the buffer */
+void microtags_flush_binary(microtags_send_block_t microtags_send_block);
+
+#ifndef MICROTAGS_STREAM
+/* Function to send out all microtags from the buffer as delta/varint coded
+ * binary blocks and clear the buffer (not with MICROTAGS_STREAM) */
+void microtags_flush_delta(microtags_send_block_t microtags_send_block);
+#endif
+
 /* Function to clear the buffer */
 void microtags_clear(void);
 
+#ifdef MICROTAGS_STREAM
+/* Function to send out up to max_bytes bytes of pending microtags, e.g. from
+ * the main loop or from a TX-empty ISR (only with MICROTAGS_STREAM) */
+size_t microtags_pump(microtags_send_byte_t microtags_send_byte,
+        size_t max_bytes);
+
+/* Function to return the number of microtags dropped due to a full ring
+ * buffer (only with MICROTAGS_STREAM) */
+uint32_t microtags_get_dropped(void);
+#endif
+
+#ifdef MICROTAGS_HOST
+/* Function to hand over the calling thread's microtags such that they are
+ * sent out by the next flush (only with MICROTAGS_HOST) */
+void microtags_host_thread_flush(void);
+
+/* Function to start a thread sending out microtags as binary blocks every
+ * period_ms milliseconds (only with MICROTAGS_HOST) */
+int microtags_host_collector_start(
+        microtags_send_block_t microtags_send_block, uint32_t period_ms);
+
+/* Function to stop the collector thread (only with MICROTAGS_HOST) */
+void microtags_host_collector_stop(void);
+#endif
+
+#ifdef __cplusplus
+}
+
+/* C++ variants of the functions to set microtags taking the id as template
+ * argument, such that disabled microtags are discarded at compile time */
+template <uint_fast16_t id>
+inline void microtags_set_ticks() {
+#if __cplusplus >= 201703L
+    if constexpr (MICROTAGS_ENABLED(id)) {
+#else
+    if (MICROTAGS_ENABLED(id)) {
+#endif
+        microtags_set_ticks(id);
+    }
+}
+
+template <uint_fast16_t id>
+inline void microtags_set_data(uint_fast32_t data) {
+#if __cplusplus >= 201703L
+    if constexpr (MICROTAGS_ENABLED(id)) {
+#else
+    if (MICROTAGS_ENABLED(id)) {
+#endif
+        microtags_set_data(id, data);
+    }
+}
+
+#endif
 
 #endif
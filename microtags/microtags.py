@@ -1,6 +1,7 @@
 #!/usr/bin/python
 
 import sys
+import struct
 
 #
 # _____________________________________________________________________________
@@ -111,6 +112,15 @@ class Microtag(object):
         self.tagData = int(hexCode[0:8], base=16)
         self.tagId = int(hexCode[8:12], base=16)
 
+    def importFromRecord(self, record):
+
+        # record must be a packed (binary) microtag of length 6
+        if not isinstance(record, str) or len(record) != 6:
+            raise Exception('Invalid record "{0}"'.format(record.encode('hex')))
+
+        # extract data and id from big-endian record
+        self.tagData, self.tagId = struct.unpack('>IH', record)
+
     def exportCode(self):
         hexCode = '{0:08X}{1:04X}'.format(self.tagData, self.tagId)
         return hexCode.encode('base64')
@@ -205,11 +215,46 @@ class MicrotagData(MicrotagUntyped):
 # _____________________________________________________________________________
 #
 class MicrotagList(object):
-    def __init__(self, idDict=None, dataToTime=None):
+
+    # binary block header (see microtags.h)
+    BLOCK_SYNC = 0xB5
+    BLOCK_PACKED = 0x01
+    BLOCK_DELTA = 0x02
+    BLOCK_HEADER_SIZE = 4
+
+    # reserved ids (see microtags.h)
+    ID_EPOCH_TICKS = 0xFFFB
+    ID_EPOCH = 0xFFFC
+    ID_THREAD = 0xFFFD
+    ID_CALIBRATION_BEGIN = 0xFFFE
+    ID_CALIBRATION_END = 0xFFFF
+
+    RESERVED_IDS = {
+        ID_EPOCH_TICKS: 'event:Epoch',
+        ID_EPOCH: 'data:Epoch',
+        ID_THREAD: 'data:Thread',
+        ID_CALIBRATION_BEGIN: 'start:Calibration',
+        ID_CALIBRATION_END: 'stop:Calibration'
+    }
+
+    # microtag types within delta/varint coded blocks (see microtags.h)
+    DELTA_TICKS = 0
+    DELTA_KEYFRAME = 1
+    DELTA_DATA = 2
+
+    def __init__(self, idDict=None, dataToTime=None, inlineIds=None):
         self.rawTags = []
         self.analysedTags = None
         self.idDict = idDict if idDict is not None else {}
 
+        # ids of the stop tags set by the inline path (microtags_inline.h),
+        # whose spans are corrected by the calibrated overhead
+        self.inlineIds = set(inlineIds) if inlineIds is not None else set()
+
+        # instrumentation overhead (in data units, i.e. ticks) of a span
+        # recorded by the inline path
+        self.overhead = 0
+
         # conversion function from data (ticks) to time
         if dataToTime is not None:
             self.dataToTime = dataToTime
@@ -226,6 +271,19 @@ class MicrotagList(object):
         tStop = self.dataToTime(dStop)
         return '{0:,.{2}f} {1}'.format(tStop[0] - tStart[0], tStop[1], tStop[2])
 
+    def getOverhead(self):
+        return self.overhead
+
+    def getSpanData(self, stopTag):
+        # data of start and stop tag of a span, corrected by the
+        # instrumentation overhead if recorded by the inline path (which the
+        # calibration measures; other paths have a different overhead)
+        dStart = self.getAnalysedTags()[stopTag.getStartTagIndex()].getTagData()
+        dStop = stopTag.getTagData()
+        if stopTag.getTagId() in self.inlineIds:
+            dStop -= self.overhead
+        return dStart, dStop
+
     def getRawTags(self):
         return self.rawTags
 
@@ -240,13 +298,27 @@ class MicrotagList(object):
         # a list of indices referring to unmatched start tags
         unmatchedStarts = []
 
+        # the thread the microtags are recorded by (as announced by thread
+        # markers from MICROTAGS_HOST) and the threads of unmatched start tags
+        thread = None
+        startThreads = {}
+
+        # the 64-bit ticks of the last ticks-based microtag and the upper 32
+        # bits announced by an epoch marker (if pending), per thread
+        lastTicks = {}
+        epochs = {}
+
+        # reserved ids may be overridden by the user's dictionary
+        idDict = dict(MicrotagList.RESERVED_IDS)
+        idDict.update(self.idDict)
+
         # iterate over all raw microtags
         for i, tag in enumerate(self.getRawTags()):
 
-            if tag.getTagId() in self.idDict:
+            if tag.getTagId() in idDict:
 
                 # microtag id alias from dictionary
-                idAlias = self.idDict[tag.tagId]
+                idAlias = idDict[tag.tagId]
 
                 # extract microtag type (start, stop, event, data)
                 if idAlias.startswith('start:'):
@@ -263,17 +335,34 @@ class MicrotagList(object):
             else:
                 analysedTag = MicrotagUntyped(tag)
 
+            if tag.getTagId() == MicrotagList.ID_THREAD:
+
+                # subsequent microtags are from this thread
+                thread = tag.getTagData()
+
+            if tag.getTagId() == MicrotagList.ID_EPOCH:
+
+                # upper 32 bits of the next ID_EPOCH_TICKS microtag
+                epochs[thread] = tag.getTagData()
+
+            if isinstance(analysedTag, MicrotagTickBased):
+
+                # extend the ticks to a 64-bit timeline
+                MicrotagList.unwrapTicks(analysedTag, thread, lastTicks, epochs)
+
             if isinstance(analysedTag, MicrotagStart):
 
                 # add indices of start tags to list of unmatched start tags
                 unmatchedStarts += [i]
+                startThreads[i] = thread
 
             elif isinstance(analysedTag, MicrotagStop):
 
                 # find corresponding start tag
                 matchingStarts = [j for j in unmatchedStarts[::-1] \
                                   if isinstance(self.getAnalysedTags()[j], MicrotagStart) \
-                                  and self.getAnalysedTags()[j].getIdAlias() == analysedTag.getIdAlias()]
+                                  and self.getAnalysedTags()[j].getIdAlias() == analysedTag.getIdAlias() \
+                                  and startThreads[j] == thread]
                 if len(matchingStarts) > 0:
                     del unmatchedStarts[unmatchedStarts.index(matchingStarts[0])]
 
@@ -282,6 +371,28 @@ class MicrotagList(object):
 
             self.analysedTags += [analysedTag]
 
+        # the instrumentation overhead is the shortest calibration span
+        overheads = [tag.getTagData() - self.getAnalysedTags()[tag.getStartTagIndex()].getTagData()
+                     for tag in self.getAnalysedTags()
+                     if isinstance(tag, MicrotagStop) and tag.getStartTagIndex() is not None
+                     and tag.getTagId() == MicrotagList.ID_CALIBRATION_END]
+        self.overhead = min(overheads) if len(overheads) > 0 else 0
+
+    @staticmethod
+    def unwrapTicks(tag, thread, lastTicks, epochs):
+        # extend the 32-bit ticks of a ticks-based microtag to a monotonic
+        # 64-bit timeline (starting in epoch 0 until the first epoch marker)
+        ticks = tag.getTagData() & 0xFFFFFFFF
+        last = lastTicks.get(thread)
+        if tag.getTagId() == MicrotagList.ID_EPOCH_TICKS \
+                and epochs.get(thread) is not None:
+            # an epoch marker tells the absolute ticks
+            tag.tagData = (epochs.pop(thread) << 32) | ticks
+        elif last is not None:
+            # the tick counter only moves forward (modulo 2^32)
+            tag.tagData = last + ((ticks - last) & 0xFFFFFFFF)
+        lastTicks[thread] = tag.getTagData()
+
     def __len__(self):
         return len(self.rawTags)
 
@@ -354,8 +465,7 @@ class MicrotagList(object):
                     line += '<<unmatched>>'
                 else:
                     # time difference
-                    line += '{0:>20}'.format(self.dataToTimeDiffStr(
-                        self.getAnalysedTags()[tag.getStartTagIndex()].getTagData(), tag.getTagData()))
+                    line += '{0:>20}'.format(self.dataToTimeDiffStr(*self.getSpanData(tag)))
 
             lines += [line]
 
@@ -376,9 +486,8 @@ class MicrotagList(object):
             tDiff = 0
             tUnits = self.dataToTime(tag.getTagData())[1]
             if isinstance(tag, MicrotagStop):
-                tStart = self.dataToTime(self.getAnalysedTags()[tag.getStartTagIndex()].getTagData())
-                tStop = self.dataToTime(tag.getTagData())
-                tDiff = tStop[0] - tStart[0]
+                dStart, dStop = self.getSpanData(tag)
+                tDiff = self.dataToTime(dStop)[0] - self.dataToTime(dStart)[0]
 
             tagType = dict(MicrotagStart='start', MicrotagStop='stop',
                            MicrotagEvent='event', MicrotagData='data').get(tag.className(), '')
@@ -401,9 +510,8 @@ class MicrotagList(object):
             tUnits = self.dataToTime(tag.getTagData())[1]
             line = ''
             if isinstance(tag, MicrotagStop):
-                tStart = self.dataToTime(self.getAnalysedTags()[tag.getStartTagIndex()].getTagData())
-                tStop = self.dataToTime(tag.getTagData())
-                tDiff = tStop[0] - tStart[0]
+                dStart, dStop = self.getSpanData(tag)
+                tDiff = self.dataToTime(dStop)[0] - self.dataToTime(dStart)[0]
 
             tagType = dict(MicrotagStart='start', MicrotagStop='stop',
                            MicrotagEvent='event', MicrotagData='data').get(tag.className(), '')
@@ -445,6 +553,89 @@ class MicrotagList(object):
         else:
             return 0
 
+    def importFromBlock(self, blockFormat, payload):
+        lenBefore = len(self.rawTags)
+        if blockFormat == MicrotagList.BLOCK_PACKED:
+            for i in range(0, len(payload) - len(payload) % 6, 6):
+                tag = Microtag()
+                tag.importFromRecord(payload[i:i + 6])
+                self.rawTags += [tag]
+        elif blockFormat == MicrotagList.BLOCK_DELTA:
+            # ticks of previous ticks-based tag (unknown until keyframe)
+            ticks = None
+            i = 0
+            while i < len(payload):
+                head, i = MicrotagList.readVarint(payload, i)
+                value, i = MicrotagList.readVarint(payload, i)
+                tagType = head & 0x3
+                tag = Microtag()
+                tag.tagId = head >> 2
+                if tagType == MicrotagList.DELTA_KEYFRAME:
+                    ticks = value
+                    tag.tagData = ticks
+                elif tagType == MicrotagList.DELTA_TICKS:
+                    if ticks is None:
+                        # cannot resolve delta without a keyframe
+                        continue
+                    # undo zig-zag coding, then apply delta modulo 2^32
+                    delta = (value >> 1) ^ -(value & 1)
+                    ticks = (ticks + delta) & 0xFFFFFFFF
+                    tag.tagData = ticks
+                else:
+                    tag.tagData = value
+                self.rawTags += [tag]
+        # return the number of tags imported
+        return len(self.rawTags) - lenBefore
+
+    @staticmethod
+    def readVarint(data, i):
+        # decode an unsigned LEB128 varint starting at data[i]
+        value = 0
+        shift = 0
+        while True:
+            if i >= len(data):
+                raise Exception('Truncated varint')
+            byte = ord(data[i])
+            i += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                # return the value and the index following the varint
+                return value, i
+
+    def importFromBinary(self, data):
+        lenBefore = len(self.rawTags)
+        formats = [MicrotagList.BLOCK_PACKED, MicrotagList.BLOCK_DELTA]
+        i = 0
+        while i + MicrotagList.BLOCK_HEADER_SIZE <= len(data):
+            # skip bytes until a plausible block header is found
+            if ord(data[i]) != MicrotagList.BLOCK_SYNC \
+                    or ord(data[i + 1]) not in formats:
+                i += 1
+                continue
+            blockFormat = ord(data[i + 1])
+            length = struct.unpack('>H', data[i + 2:i + 4])[0]
+            start = i + MicrotagList.BLOCK_HEADER_SIZE
+            if start + length > len(data):
+                # truncated block
+                break
+            try:
+                self.importFromBlock(blockFormat, data[start:start + length])
+            except:
+                # corrupt block, resync at the next header
+                pass
+            i = start + length
+        # return the number of tags imported
+        return len(self.rawTags) - lenBefore
+
+    def importFromBinaryFile(self, _file):
+        # If user gave a filename open it, otherwise work with content
+        try:
+            f = open(_file, 'rb')
+        except TypeError:
+            f = _file
+        return self.importFromBinary(f.read())
+
     def printList(self):
         pass
 
@@ -471,8 +662,15 @@ def main(argv):
     # read input file
     microtags = MicrotagList(idDict, lambda c: (c / 84E6, 's', 3))
 
+    # binary captures start with a block header, text captures don't
+    with open(filename, 'rb') as f:
+        isBinary = f.read(1) == chr(MicrotagList.BLOCK_SYNC)
+
     # try:
-    n = microtags.importFromFile(filename)
+    if isBinary:
+        n = microtags.importFromBinaryFile(filename)
+    else:
+        n = microtags.importFromFile(filename)
     print('Imported {0} microtag(s).'.format(n))
 
     # except:
@@ -0,0 +1,238 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development 
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef MICROTAGS_ATOMIC_H_
+#define MICROTAGS_ATOMIC_H_
+
+#include <stdint.h>
+
+/*
+ * Minimal set of atomic counter operations used to reserve and commit
+ * microtag slots from interrupt and thread context without disabling
+ * interrupts around the whole recording. The implementation is chosen
+ * depending on the target:
+ *
+ *  - ARMv7-M / ARMv8-M mainline (Cortex-M3/M4/M7/M33): LDREX/STREX
+ *  - ARMv6-M (Cortex-M0/M0+): PRIMASK around the read-modify-write only
+ *  - everything else (hosts): C11 <stdatomic.h>
+ */
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) \
+        || defined(__ARM_ARCH_8M_MAIN__)
+
+    #define MICROTAGS_ATOMIC_LDREX
+
+    typedef volatile uint32_t microtags_atomic_t;
+
+#elif defined(__ARM_ARCH_6M__) || defined(__ARM_ARCH_8M_BASE__)
+
+    #define MICROTAGS_ATOMIC_PRIMASK
+
+    typedef volatile uint32_t microtags_atomic_t;
+
+#else
+
+    #define MICROTAGS_ATOMIC_C11
+
+    #include <stdatomic.h>
+
+    typedef atomic_uint_fast32_t microtags_atomic_t;
+
+#endif
+
+
+/*
+ * Function to read the current value of an atomic counter
+ * ___________________________________________________________________________
+ */
+static inline uint_fast32_t microtags_atomic_load(microtags_atomic_t* a) {
+
+#ifdef MICROTAGS_ATOMIC_C11
+    return atomic_load_explicit(a, memory_order_acquire);
+#else
+    uint_fast32_t value = *a;
+    __asm__ volatile ("" ::: "memory");
+    return value;
+#endif
+}
+
+
+/*
+ * Function to reserve <count> consecutive slots in a buffer of <max> slots.
+ * Returns the index of the first reserved slot or <max> if there is not
+ * enough space left (in which case nothing is reserved)
+ * ___________________________________________________________________________
+ */
+static inline uint_fast32_t microtags_atomic_reserve(
+        microtags_atomic_t* a, uint_fast32_t count, uint_fast32_t max) {
+
+#if defined(MICROTAGS_ATOMIC_LDREX)
+
+    uint32_t n;
+    uint32_t failed;
+
+    do {
+        __asm__ volatile ("ldrex %0, [%1]" : "=r" (n) : "r" (a) : "memory");
+        if (n + count > max) {
+            /* release the exclusive monitor and give up */
+            __asm__ volatile ("clrex" ::: "memory");
+            return max;
+        }
+        /* fails (and retries) if anybody, e.g. an ISR, touched *a in between */
+        __asm__ volatile ("strex %0, %2, [%1]"
+                : "=&r" (failed) : "r" (a), "r" (n + count) : "memory");
+    } while (failed != 0);
+
+    return n;
+
+#elif defined(MICROTAGS_ATOMIC_PRIMASK)
+
+    uint32_t primask;
+    uint32_t n;
+
+    __asm__ volatile ("mrs %0, primask\n cpsid i" : "=r" (primask) :: "memory");
+    n = *a;
+    if (n + count > max) {
+        n = max;
+    } else {
+        *a = n + count;
+    }
+    __asm__ volatile ("msr primask, %0" :: "r" (primask) : "memory");
+
+    return n;
+
+#else
+
+    uint_fast32_t n = atomic_load_explicit(a, memory_order_relaxed);
+
+    do {
+        if (n + count > max) {
+            return max;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(
+            a, &n, n + count, memory_order_acquire, memory_order_relaxed));
+
+    return n;
+
+#endif
+}
+
+
+/*
+ * Function to atomically add <value> to an atomic counter (with release
+ * semantics, i.e. all stores before are visible once the sum is visible)
+ * ___________________________________________________________________________
+ */
+static inline void microtags_atomic_add(
+        microtags_atomic_t* a, uint_fast32_t value) {
+
+#if defined(MICROTAGS_ATOMIC_LDREX)
+
+    uint32_t n;
+    uint32_t failed;
+
+    __asm__ volatile ("dmb" ::: "memory");
+    do {
+        __asm__ volatile ("ldrex %0, [%1]" : "=r" (n) : "r" (a) : "memory");
+        __asm__ volatile ("strex %0, %2, [%1]"
+                : "=&r" (failed) : "r" (a), "r" (n + value) : "memory");
+    } while (failed != 0);
+
+#elif defined(MICROTAGS_ATOMIC_PRIMASK)
+
+    uint32_t primask;
+
+    __asm__ volatile ("mrs %0, primask\n cpsid i" : "=r" (primask) :: "memory");
+    *a += value;
+    __asm__ volatile ("msr primask, %0" :: "r" (primask) : "memory");
+
+#else
+
+    atomic_fetch_add_explicit(a, value, memory_order_release);
+
+#endif
+}
+
+
+/*
+ * Function to atomically subtract <value> from an atomic counter
+ * ___________________________________________________________________________
+ */
+static inline void microtags_atomic_sub(
+        microtags_atomic_t* a, uint_fast32_t value) {
+
+    /* modulo arithmetic makes this an addition of the two's complement */
+    microtags_atomic_add(a, (uint_fast32_t)0 - value);
+}
+
+
+/*
+ * Function to atomically replace <expected> by <desired>. Returns non-zero
+ * on success and zero if the counter did not hold <expected>
+ * ___________________________________________________________________________
+ */
+static inline int microtags_atomic_cas(microtags_atomic_t* a,
+        uint_fast32_t expected, uint_fast32_t desired) {
+
+#if defined(MICROTAGS_ATOMIC_LDREX)
+
+    uint32_t n;
+    uint32_t failed;
+
+    do {
+        __asm__ volatile ("ldrex %0, [%1]" : "=r" (n) : "r" (a) : "memory");
+        if (n != expected) {
+            __asm__ volatile ("clrex" ::: "memory");
+            return 0;
+        }
+        __asm__ volatile ("strex %0, %2, [%1]"
+                : "=&r" (failed) : "r" (a), "r" (desired) : "memory");
+    } while (failed != 0);
+
+    return 1;
+
+#elif defined(MICROTAGS_ATOMIC_PRIMASK)
+
+    uint32_t primask;
+    int success = 0;
+
+    __asm__ volatile ("mrs %0, primask\n cpsid i" : "=r" (primask) :: "memory");
+    if (*a == expected) {
+        *a = desired;
+        success = 1;
+    }
+    __asm__ volatile ("msr primask, %0" :: "r" (primask) : "memory");
+
+    return success;
+
+#else
+
+    return atomic_compare_exchange_strong_explicit(a, &expected, desired,
+            memory_order_acq_rel, memory_order_acquire) ? 1 : 0;
+
+#endif
+}
+
+
+#endif
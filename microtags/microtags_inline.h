@@ -0,0 +1,202 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development 
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef MICROTAGS_INLINE_H_
+#define MICROTAGS_INLINE_H_
+
+/*
+ * Header-only fast path to set microtags without any function call: the
+ * tick counter is read directly from the CPU's cycle counter and the
+ * microtag is stored right into the buffer of microtags.c. Requires
+ * microtags.c to be compiled with MICROTAGS_INLINE (and the same other
+ * options as the code including this header), in which case microtags.c
+ * uses the cycle counter as tick source as well. Only the default and the
+ * MICROTAGS_ATOMIC buffer are supported.
+ */
+
+#include "microtags.h"
+
+#if defined(MICROTAGS_STREAM) || defined(MICROTAGS_COMPACT)
+    #error "microtags_inline.h cannot be used with STREAM or COMPACT"
+#endif
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) \
+        || defined(__ARM_ARCH_8M_MAIN__)
+
+    /* Cortex-M with data watchpoint and trace unit (DWT) */
+    #define MICROTAGS_DWT_CTRL      (*(volatile uint32_t*)0xE0001000)
+    #define MICROTAGS_DWT_CYCCNT    (*(volatile uint32_t*)0xE0001004)
+    #define MICROTAGS_DWT_LAR       (*(volatile uint32_t*)0xE0001FB0)
+    #define MICROTAGS_DEMCR         (*(volatile uint32_t*)0xE000EDFC)
+
+#elif defined(__x86_64__) || defined(__i386__)
+
+    #include <x86intrin.h>
+
+#else
+
+    /* externally defined function to return current tick counter */
+    extern uint32_t microtags_get_ticks(void);
+
+#endif
+
+#ifdef MICROTAGS_ATOMIC
+    #include "microtags_atomic.h"
+#endif
+
+#ifndef MICROTAGS_GET_TICKS
+    #define MICROTAGS_GET_TICKS() microtags_cycles()
+#endif
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the buffer of microtags.c (shared if compiled with MICROTAGS_INLINE) */
+extern microtag_t buf_microtags[MICROTAGS_N_MAX];
+
+#ifdef MICROTAGS_ATOMIC
+extern microtags_atomic_t n_microtags;
+extern microtags_atomic_t n_microtags_committed;
+#else
+extern uint_fast16_t n_microtags;
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+
+/*
+ * Function to enable the cycle counter (only needed on Cortex-M)
+ * ___________________________________________________________________________
+ */
+static inline void microtags_cycles_init(void) {
+
+#ifdef MICROTAGS_DWT_CYCCNT
+    /* enable trace (TRCENA) ... */
+    MICROTAGS_DEMCR |= 0x01000000;
+    /* ... unlock DWT (only needed on Cortex-M7) ... */
+    MICROTAGS_DWT_LAR = 0xC5ACCE55;
+    /* ... and start the cycle counter (CYCCNTENA) */
+    MICROTAGS_DWT_CYCCNT = 0;
+    MICROTAGS_DWT_CTRL |= 0x00000001;
+#endif
+}
+
+
+/*
+ * Function to return the (lower 32 bits of the) CPU's cycle counter
+ * ___________________________________________________________________________
+ */
+static inline uint32_t microtags_cycles(void) {
+
+#if defined(MICROTAGS_DWT_CYCCNT)
+    return MICROTAGS_DWT_CYCCNT;
+#elif defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__rdtsc();
+#else
+    return microtags_get_ticks();
+#endif
+}
+
+
+/*
+ * Function to write a microtag to the buffer
+ * ___________________________________________________________________________
+ */
+static inline void microtags_store_inline(
+        uint_fast32_t data, uint_fast16_t id, uint_fast16_t kind) {
+
+#ifdef MICROTAGS_ATOMIC
+
+    uint_fast32_t i = microtags_atomic_reserve(&n_microtags, 1, MICROTAGS_N_MAX);
+
+    if (i < MICROTAGS_N_MAX) {
+        buf_microtags[i].data = data;
+        buf_microtags[i].id = id;
+        buf_microtags[i].kind = kind;
+        microtags_atomic_add(&n_microtags_committed, 1);
+    }
+
+#else
+
+    if (n_microtags < MICROTAGS_N_MAX) {
+        buf_microtags[n_microtags].data = data;
+        buf_microtags[n_microtags].kind = kind;
+        buf_microtags[n_microtags++].id = id;
+    }
+
+#endif
+}
+
+
+/*
+ * Function to set a ticks-based microtag without any function call
+ * ___________________________________________________________________________
+ */
+static inline void microtags_set_ticks_inline(uint_fast16_t id) {
+
+    microtags_store_inline(MICROTAGS_GET_TICKS(), id, MICROTAGS_KIND_TICKS);
+}
+
+
+/*
+ * Function to set a data-based microtag without any function call
+ * ___________________________________________________________________________
+ */
+static inline void microtags_set_data_inline(
+        uint_fast16_t id, uint_fast32_t data) {
+
+    microtags_store_inline(data, id, MICROTAGS_KIND_DATA);
+}
+
+
+/*
+ * Function to measure the overhead of instrumenting a span on the inline
+ * path, i.e. to set an empty pair of calibration microtags. The difference
+ * of their ticks is the overhead, which the analysis (microtags.py)
+ * subtracts from the spans recorded on the inline path (those with the ids
+ * passed as inlineIds; it takes the shortest calibration span if called
+ * more than once).
+ * ___________________________________________________________________________
+ */
+static inline void microtags_calibrate(void) {
+
+    microtags_set_ticks_inline(MICROTAGS_ID_CALIBRATION_BEGIN);
+    microtags_set_ticks_inline(MICROTAGS_ID_CALIBRATION_END);
+}
+
+
+#define MICROTAGS_SET_TICKS_INLINE(id) do { \
+        if (MICROTAGS_ENABLED(id)) { microtags_set_ticks_inline(id); } \
+        } while (0)
+
+#define MICROTAGS_SET_DATA_INLINE(id, data) do { \
+        if (MICROTAGS_ENABLED(id)) { microtags_set_data_inline(id, data); } \
+        } while (0)
+
+
+#endif
@@ -0,0 +1,215 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development 
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+/* for mremap() and sync_file_range() */
+#define _GNU_SOURCE
+
+#include "microtags_mmap.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifndef MICROTAGS_MMAP_CHUNK_SIZE
+    #define MICROTAGS_MMAP_CHUNK_SIZE (4 * 1024 * 1024)
+#endif
+
+#ifndef MICROTAGS_MMAP_SYNC_SIZE
+    #define MICROTAGS_MMAP_SYNC_SIZE (1024 * 1024)
+#endif
+
+/* the trace file and its mapping */
+static int fd_mmap = -1;
+static uint8_t* mem_mmap = 0;
+
+/* the size of the trace file (and the mapping) ... */
+static size_t size_mmap = 0;
+
+/* ... the number of bytes written ... */
+static size_t len_mmap = 0;
+
+/* ... and the number of bytes handed over for write-back */
+static size_t len_synced = 0;
+
+/* the number of bytes dropped */
+static uint32_t n_dropped_mmap = 0;
+
+
+/*
+ * Function to extend the trace file (and the mapping) such that at least
+ * <len> bytes fit in. Returns 0 on success
+ * ___________________________________________________________________________
+ */
+static int microtags_mmap_grow(size_t len) {
+
+    size_t size = ((len + MICROTAGS_MMAP_CHUNK_SIZE - 1)
+            / MICROTAGS_MMAP_CHUNK_SIZE) * MICROTAGS_MMAP_CHUNK_SIZE;
+    void* mem;
+
+    if (ftruncate(fd_mmap, (off_t)size) != 0) {
+        return -1;
+    }
+
+    if (mem_mmap == 0) {
+        mem = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_mmap, 0);
+    } else {
+        mem = mremap(mem_mmap, size_mmap, size, MREMAP_MAYMOVE);
+    }
+
+    if (mem == MAP_FAILED) {
+        /* keep the file consistent with the (old) mapping */
+        if (ftruncate(fd_mmap, (off_t)size_mmap) != 0) {
+            /* nothing left to do */
+        }
+        return -1;
+    }
+
+    mem_mmap = (uint8_t*)mem;
+    size_mmap = size;
+
+    /* the trace is written (and read back) front to back */
+    madvise(mem_mmap, size_mmap, MADV_SEQUENTIAL);
+
+    return 0;
+}
+
+
+/*
+ * Function to start write-back of all complete pages written so far
+ * ___________________________________________________________________________
+ */
+static void microtags_mmap_sync(void) {
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t len = (len_mmap / page) * page;
+
+    if (len > len_synced) {
+        /* kick off write-back without waiting for it ... */
+        sync_file_range(fd_mmap, (off_t)len_synced, (off_t)(len - len_synced),
+                SYNC_FILE_RANGE_WRITE);
+        /* ... and drop the pages from our mapping as they are not touched
+         * again (the data stays in the page cache) */
+        madvise(mem_mmap + len_synced, len - len_synced, MADV_DONTNEED);
+        len_synced = len;
+    }
+}
+
+
+/*
+ * Function to create (or truncate) the trace file and map it
+ * ___________________________________________________________________________
+ */
+int microtags_mmap_open(const char* path) {
+
+    if (fd_mmap >= 0) {
+        /* already open */
+        return -1;
+    }
+
+    fd_mmap = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_mmap < 0) {
+        return -1;
+    }
+
+    len_mmap = 0;
+    len_synced = 0;
+    n_dropped_mmap = 0;
+
+    if (microtags_mmap_grow(MICROTAGS_MMAP_CHUNK_SIZE) != 0) {
+        close(fd_mmap);
+        fd_mmap = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Function to append a block to the trace file
+ * ___________________________________________________________________________
+ */
+void microtags_mmap_send_block(const uint8_t* block, size_t len) {
+
+    if (mem_mmap == 0) {
+        return;
+    }
+
+    if (len_mmap + len > size_mmap
+            && microtags_mmap_grow(len_mmap + len) != 0) {
+        /* trace file cannot be extended, drop block */
+        n_dropped_mmap += len;
+        return;
+    }
+
+    memcpy(mem_mmap + len_mmap, block, len);
+    len_mmap += len;
+
+    if (len_mmap - len_synced >= MICROTAGS_MMAP_SYNC_SIZE) {
+        microtags_mmap_sync();
+    }
+}
+
+
+/*
+ * Function to return the number of bytes dropped
+ * ___________________________________________________________________________
+ */
+uint32_t microtags_mmap_get_dropped(void) {
+
+    return n_dropped_mmap;
+}
+
+
+/*
+ * Function to unmap the trace file and cut it to the bytes written
+ * ___________________________________________________________________________
+ */
+int microtags_mmap_close(void) {
+
+    int ret = 0;
+
+    if (fd_mmap < 0) {
+        return -1;
+    }
+
+    if (mem_mmap != 0) {
+        munmap(mem_mmap, size_mmap);
+        mem_mmap = 0;
+    }
+
+    if (ftruncate(fd_mmap, (off_t)len_mmap) != 0) {
+        ret = -1;
+    }
+
+    if (close(fd_mmap) != 0) {
+        ret = -1;
+    }
+
+    fd_mmap = -1;
+    size_mmap = 0;
+
+    return ret;
+}
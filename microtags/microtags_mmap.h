@@ -0,0 +1,73 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development 
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef MICROTAGS_MMAP_H_
+#define MICROTAGS_MMAP_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Trace file sink for microtags on (Linux) hosts: binary blocks handed out
+ * by microtags_flush_binary() or microtags_flush_delta() (e.g. from the
+ * collector thread of MICROTAGS_HOST) are copied straight into a shared
+ * memory mapping of the trace file, which grows in steps of
+ * MICROTAGS_MMAP_CHUNK_SIZE bytes (default: 4 MiB). Written-back ranges are
+ * handed to the kernel every MICROTAGS_MMAP_SYNC_SIZE bytes (default: 1 MiB)
+ * without waiting for the disk. As the data lives in the page cache, the
+ * trace file stays readable (by microtags.py) even if the process crashes;
+ * the unused (zero) tail is then simply skipped.
+ *
+ * Note that this is a copy sink: recording does not store into the mapping.
+ * With MICROTAGS_HOST, threads keep recording into their own heap chunks,
+ * which are encoded into blocks and copied into the mapping when flushed.
+ * Microtags not yet flushed when the process crashes are therefore lost.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Function to create (or truncate) the trace file and map it. Returns 0 on
+ * success */
+int microtags_mmap_open(const char* path);
+
+/* Function to append a block to the trace file (to be passed as
+ * microtags_send_block_t) */
+void microtags_mmap_send_block(const uint8_t* block, size_t len);
+
+/* Function to return the number of bytes dropped since the trace file could
+ * not be extended */
+uint32_t microtags_mmap_get_dropped(void);
+
+/* Function to unmap the trace file and cut it to the bytes written.
+ * Returns 0 on success */
+int microtags_mmap_close(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
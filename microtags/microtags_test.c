@@ -0,0 +1,218 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+/*
+ * Host round trip test of the microtag encodings against microtags.py,
+ * e.g.
+ *
+ *  gcc -o microtags_test microtags_test.c microtags.c
+ *  ./microtags_test delta tags.out tags.exp
+ *  python microtags_test.py tags.out tags.exp
+ *
+ * (with the same MICROTAGS_* options as microtags.c, and
+ * ../ringbuffers/ringbuffer.c with MICROTAGS_STREAM, or -pthread and
+ * -D'MICROTAGS_GET_TICKS()=({ extern uint32_t microtags_get_ticks(void);
+ * microtags_get_ticks(); })' with MICROTAGS_HOST and MICROTAGS_INLINE to
+ * use the simulated tick counter below).
+ * The encoding is one of text, binary or delta (not with MICROTAGS_STREAM).
+ * Microtags with random ids are set from a simulated 64-bit tick counter
+ * advancing in random steps across many wrap-arounds, with epoch markers
+ * in between, and flushed in random portions. Ids below TEST_ID_DATA are
+ * ticks-based, the others (up to the reserved ids) data-based. The encoded
+ * output is written to the first file, the encoding and the expected ids
+ * and data (with 64-bit ticks) to the second one.
+ */
+
+#include "microtags.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* the number of microtags to set */
+#define TEST_TAGS           20000
+
+/* the number of microtags set per flush at most (of the default
+ * MICROTAGS_N_MAX, leaving room for a microtag and an epoch marker) */
+#define TEST_FLUSH_MAX      120
+
+/* the first id of data-based microtags (as told to microtags_test.py) */
+#define TEST_ID_DATA        0x8000
+
+
+/* the simulated 64-bit tick counter */
+static uint64_t ticks = 16;
+
+/* the file the encoded microtags are sent to */
+static FILE* out;
+
+
+/*
+ * Function to return the lower 32 bits of the simulated tick counter
+ * ___________________________________________________________________________
+ */
+uint32_t microtags_get_ticks(void) {
+
+    return (uint32_t)ticks;
+}
+
+
+/*
+ * Function to send out one byte
+ * ___________________________________________________________________________
+ */
+static void test_send_byte(uint8_t byte) {
+
+    fputc(byte, out);
+}
+
+
+/*
+ * Function to send out a block of len bytes
+ * ___________________________________________________________________________
+ */
+static void test_send_block(const uint8_t* block, size_t len) {
+
+    fwrite(block, 1, len, out);
+}
+
+
+/*
+ * Function to send out all microtags from the buffer in the given encoding
+ * ___________________________________________________________________________
+ */
+static void test_flush(const char* encoding) {
+
+    if (strcmp(encoding, "text") == 0) {
+        microtags_flush_text(&test_send_byte);
+    } else if (strcmp(encoding, "binary") == 0) {
+        microtags_flush_binary(&test_send_block);
+    } else {
+#ifndef MICROTAGS_STREAM
+        microtags_flush_delta(&test_send_block);
+#endif
+    }
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+int main(int argc, char* argv[]) {
+
+    /* the ticks of the last epoch marker */
+    uint64_t ticksEpoch = 0;
+
+    FILE* expected;
+    int nflush = 0;
+    int i;
+
+    if (argc != 4 || (strcmp(argv[1], "text") != 0
+            && strcmp(argv[1], "binary") != 0
+            && strcmp(argv[1], "delta") != 0)) {
+        fprintf(stderr, "usage: %s text|binary|delta <output> <expected>\n",
+                argv[0]);
+        return 1;
+    }
+#ifdef MICROTAGS_STREAM
+    if (strcmp(argv[1], "delta") == 0) {
+        fprintf(stderr, "delta encoding not available with MICROTAGS_STREAM\n");
+        return 1;
+    }
+#endif
+    out = fopen(argv[2], "wb");
+    expected = fopen(argv[3], "w");
+    if (out == 0 || expected == 0) {
+        fprintf(stderr, "cannot open output files\n");
+        return 1;
+    }
+
+    srand(1);
+    fprintf(expected, "# %s\n", argv[1]);
+
+    for (i = 0; i < TEST_TAGS; ++i) {
+
+        /* mostly short steps (some beyond 16 bits), sometimes close to a
+         * wrap-around */
+        uint64_t step = (rand() % 10 == 0)
+                ? ((uint64_t)1 << 31) + (uint64_t)rand() % ((uint64_t)1 << 30)
+                : (uint64_t)rand() % ((rand() % 4 == 0) ? 100000 : 1000);
+
+        /* an epoch marker at least once per wrap-around of the 32-bit tick
+         * counter (which microtags_set_epoch() counts), and now and then */
+        if (ticks + step - ticksEpoch >= ((uint64_t)1 << 32)
+                || rand() % 20 == 0) {
+            microtags_set_epoch();
+            ticksEpoch = ticks;
+            fprintf(expected, "%u %u\n%u %llu\n", MICROTAGS_ID_EPOCH,
+                    (unsigned int)(ticks >> 32), MICROTAGS_ID_EPOCH_TICKS,
+                    (unsigned long long)ticks);
+            nflush += 2;
+        }
+        ticks += step;
+
+        /* any id but the reserved ones */
+        if (rand() % 4 == 0) {
+            uint_fast16_t id = (uint_fast16_t)(TEST_ID_DATA
+                    + rand() % (MICROTAGS_ID_EPOCH_TICKS - TEST_ID_DATA));
+            uint32_t data = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+            microtags_set_data(id, data);
+            fprintf(expected, "%u %lu\n", (unsigned int)id,
+                    (unsigned long)data);
+        } else {
+            uint_fast16_t id = (uint_fast16_t)(rand() % TEST_ID_DATA);
+            microtags_set_ticks(id);
+            fprintf(expected, "%u %llu\n", (unsigned int)id,
+                    (unsigned long long)ticks);
+        }
+
+#ifdef MICROTAGS_STREAM
+        /* drain the ring buffer partially now and then (also cutting
+         * through text lines) */
+        if (strcmp(argv[1], "text") == 0 && rand() % 5 == 0) {
+            microtags_pump(&test_send_byte, (size_t)(rand() % 40));
+        }
+#endif
+
+        if (++nflush >= TEST_FLUSH_MAX || rand() % 20 == 0) {
+            test_flush(argv[1]);
+            nflush = 0;
+        }
+    }
+    test_flush(argv[1]);
+
+    fclose(out);
+    fclose(expected);
+
+#ifdef MICROTAGS_STREAM
+    if (microtags_get_dropped() != 0) {
+        fprintf(stderr, "dropped %lu microtag(s)\n",
+                (unsigned long)microtags_get_dropped());
+        return 1;
+    }
+#endif
+
+    return 0;
+}
@@ -0,0 +1,69 @@
+#!/usr/bin/python
+
+#
+# Round trip test of the microtag encodings: decodes the output of
+# microtags_test.c with microtags.py and compares the microtags (with
+# 64-bit ticks) to the ones expected. Thread markers (MICROTAGS_HOST) are
+# skipped. Exits non-zero on any mismatch.
+#
+# Usage: microtags_test.py <output> <expected>
+#
+
+import sys
+from microtags import *
+
+
+# the first id of data-based microtags (see microtags_test.c)
+TEST_ID_DATA = 0x8000
+
+
+#
+# _____________________________________________________________________________
+#
+def main(argv):
+
+    if len(argv) != 2:
+        print "Wrong number of arguments. Stopping."
+        print "Expecting <output> <expected>"
+        return 2
+
+    # the encoding (first line) and the expected ids and data
+    f = open(argv[1], 'r')
+    encoding = f.readline().strip('# \n')
+    expected = [tuple(int(v) for v in line.split()) for line in f]
+    f.close()
+
+    # ticks-based ids need to be known to be extended to 64 bits
+    idDict = dict((i, 'event:{0:04X}'.format(i)) for i in range(TEST_ID_DATA))
+    microtags = MicrotagList(idDict)
+    if encoding == 'text':
+        microtags.importFromFile(argv[0])
+    else:
+        microtags.importFromBinaryFile(argv[0])
+    microtags.analyse()
+
+    decoded = [tag for tag in microtags.getAnalysedTags()
+               if tag.getTagId() != MicrotagList.ID_THREAD]
+
+    errors = 0
+    if len(decoded) != len(expected):
+        print 'Expected {0} microtags, decoded {1}' \
+            .format(len(expected), len(decoded))
+        errors += 1
+    for i, (tag, (tagId, data)) in enumerate(zip(decoded, expected)):
+        if tag.getTagId() != tagId or tag.getTagData() != data:
+            if errors < 10:
+                print 'Microtag {0}: expected {1:04X}:{2:X}, decoded {3:04X}:{4:X}' \
+                    .format(i, tagId, data, tag.getTagId(), tag.getTagData())
+            errors += 1
+
+    print '{0}: {1} microtags, {2}'.format(encoding, len(expected),
+                                           'ok' if errors == 0 else 'FAILED')
+    return 0 if errors == 0 else 1
+
+
+#
+# _____________________________________________________________________________
+#
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -25,6 +25,219 @@
 #include "ringbuffer.h"
 #include <string.h>
 
+#if RINGBUFFER_FRAME_PREFIX == RINGBUFFER_PREFIX_SIZE_T
+    #define RINGBUFFER_PREFIX_WIDTH sizeof(size_t)
+#elif RINGBUFFER_FRAME_PREFIX != RINGBUFFER_PREFIX_VARINT
+    #define RINGBUFFER_PREFIX_WIDTH (RINGBUFFER_FRAME_PREFIX)
+#endif
+
+#ifdef RINGBUFFER_PREFIX_WIDTH
+    /* the maximum frame length representable by the prefix */
+    #define RINGBUFFER_PREFIX_LEN_MAX ((((size_t)1 \
+            << (8 * RINGBUFFER_PREFIX_WIDTH - 1)) - 1) * 2 + 1)
+    #define RINGBUFFER_PREFIX_SIZE_MAX RINGBUFFER_PREFIX_WIDTH
+#else
+    /* 7 bits per byte */
+    #define RINGBUFFER_PREFIX_SIZE_MAX ((8 * sizeof(size_t) + 6) / 7)
+#endif
+
+
+/*
+ * ___________________________________________________________________________
+ */
+static inline size_t ringbuffer_length(ringbuffer_t* rb) {
+
+#ifdef RINGBUFFER_POW2
+    /* free-running indices (modulo arithmetic) */
+    return (size_t)(rb->iw - rb->ir);
+#else
+    return rb->len;
+#endif
+}
+
+
+/*
+ * Function to map a (possibly advanced) index to a position in the buffer
+ * ___________________________________________________________________________
+ */
+static inline size_t ringbuffer_pos(ringbuffer_t* rb, size_t index) {
+
+#ifdef RINGBUFFER_POW2
+    return index & (rb->size - 1);
+#else
+    /* assuming index never exceeds twice the size */
+    if (index >= rb->size) {
+        index -= rb->size;
+    }
+    return index;
+#endif
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+static inline void ringbuffer_advance_write(ringbuffer_t* rb, size_t len) {
+
+#ifdef RINGBUFFER_POW2
+    rb->iw += len;
+#else
+    rb->len += len;
+    rb->iw = ringbuffer_pos(rb, rb->iw + len);
+#endif
+
+#ifdef RINGBUFFER_STATS
+    rb->stats.bytesIn += len;
+    if (ringbuffer_length(rb) > rb->stats.peakLen) {
+        rb->stats.peakLen = ringbuffer_length(rb);
+    }
+#endif
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+static inline void ringbuffer_advance_read(ringbuffer_t* rb, size_t len) {
+
+#ifdef RINGBUFFER_POW2
+    rb->ir += len;
+#else
+    rb->len -= len;
+    rb->ir = ringbuffer_pos(rb, rb->ir + len);
+#endif
+
+#ifdef RINGBUFFER_STATS
+    rb->stats.bytesOut += len;
+#endif
+}
+
+
+/*
+ * Function to return the number of bytes from position pos on that are
+ * contiguous in memory
+ * ___________________________________________________________________________
+ */
+static inline size_t ringbuffer_contiguous(ringbuffer_t* rb, size_t pos) {
+
+    size_t len = (size_t)(rb->size - pos);
+
+#ifdef RINGBUFFER_MIRROR
+    if (rb->mirrored != 0) {
+        /* the mirror follows the end of the buffer */
+        len = rb->size;
+    }
+#endif
+
+    return len;
+}
+
+
+/*
+ * Function to copy len bytes to the buffer starting at position pos
+ * ___________________________________________________________________________
+ */
+static inline void ringbuffer_copy_to(
+        ringbuffer_t* rb, size_t pos, const uint8_t* data, size_t len) {
+
+    /* the number of contiguous bytes (until end of buffer) */
+    size_t tmpLen = ringbuffer_contiguous(rb, pos);
+    if (len <= tmpLen) {
+        memcpy(rb->buffer + pos, data, len);
+    } else {
+        memcpy(rb->buffer + pos, data, tmpLen);
+        /* copy remaining data to beginning of buffer */
+        memcpy(rb->buffer, data + tmpLen, len - tmpLen);
+    }
+}
+
+
+/*
+ * Function to copy len bytes from the buffer starting at position pos
+ * ___________________________________________________________________________
+ */
+static inline void ringbuffer_copy_from(
+        ringbuffer_t* rb, size_t pos, uint8_t* data, size_t len) {
+
+    /* the number of contiguous bytes (until end of buffer) */
+    size_t tmpLen = ringbuffer_contiguous(rb, pos);
+    if (len <= tmpLen) {
+        memcpy(data, rb->buffer + pos, len);
+    } else {
+        memcpy(data, rb->buffer + pos, tmpLen);
+        /* copy remaining data from beginning of buffer */
+        memcpy(data + tmpLen, rb->buffer, len - tmpLen);
+    }
+}
+
+
+/*
+ * Function to describe len bytes starting at position pos as (up to) two
+ * contiguous regions
+ * ___________________________________________________________________________
+ */
+static inline void ringbuffer_split(ringbuffer_t* rb, size_t pos,
+        ringbuffer_span_t span[2], size_t len) {
+
+    /* the number of contiguous bytes (until end of buffer) */
+    size_t tmpLen = ringbuffer_contiguous(rb, pos);
+
+    span[0].data = rb->buffer + pos;
+    span[1].data = rb->buffer;
+
+    if (len > tmpLen) {
+        span[0].len = tmpLen;
+        span[1].len = len - tmpLen;
+    } else {
+        span[0].len = len;
+        span[1].len = 0;
+    }
+}
+
+
+/*
+ * Function to account for n frames added to the content
+ * ___________________________________________________________________________
+ */
+static inline void ringbuffer_add_frames(ringbuffer_t* rb, size_t n) {
+
+    rb->nframes += n;
+#ifdef RINGBUFFER_STATS
+    rb->stats.framesIn += n;
+#endif
+}
+
+
+/*
+ * Function to account for n frames removed from the content
+ * ___________________________________________________________________________
+ */
+static inline void ringbuffer_remove_frames(ringbuffer_t* rb, size_t n) {
+
+    rb->nframes -= n;
+#ifdef RINGBUFFER_STATS
+    rb->stats.framesOut += n;
+#endif
+}
+
+
+/*
+ * Function to account for n writes of len bytes in total that have been
+ * refused for lack of space
+ * ___________________________________________________________________________
+ */
+static inline void ringbuffer_reject(ringbuffer_t* rb, size_t n, size_t len) {
+
+#ifdef RINGBUFFER_STATS
+    rb->stats.rejectedWrites += n;
+    rb->stats.rejectedBytes += len;
+#else
+    (void)rb;
+    (void)n;
+    (void)len;
+#endif
+}
+
 
 /*
  * ___________________________________________________________________________
@@ -32,11 +245,28 @@
 void ringbuffer_init(ringbuffer_t* rb, uint8_t* mem, size_t memlen) {
 
     if (rb != 0 && mem != 0) {
+
+#ifdef RINGBUFFER_POW2
+        /* round down to a power of two */
+        size_t size = 1;
+        while (size <= memlen / 2) {
+            size *= 2;
+        }
+        memlen = memlen > 0 ? size : 0;
+#endif
+
         rb->buffer = mem;
         rb->size = memlen;
-        rb->len = 0;
-        rb->iw = 0;
-        rb->ir = 0;
+#ifdef RINGBUFFER_MIRROR
+        rb->mirrored = 0;
+#endif
+#ifdef RINGBUFFER_OVERWRITE
+        rb->overwrite = 0;
+#endif
+#ifdef RINGBUFFER_STATS
+        memset(&rb->stats, 0, sizeof(rb->stats));
+#endif
+        ringbuffer_clear(rb);
     }
 }
 
@@ -49,7 +279,7 @@ size_t ringbuffer_get_len(ringbuffer_t* rb) {
     size_t len = 0;
 
     if (rb != 0) {
-        len = rb->len;
+        len = ringbuffer_length(rb);
     }
 
     return len;
@@ -65,7 +295,7 @@ size_t ringbuffer_get_space(ringbuffer_t* rb) {
 
     if (rb != 0) {
         /* assuming len never exceeds size */
-        space = (size_t)(rb->size - rb->len);
+        space = (size_t)(rb->size - ringbuffer_length(rb));
     }
 
     return space;
@@ -78,9 +308,21 @@ size_t ringbuffer_get_space(ringbuffer_t* rb) {
 void ringbuffer_clear(ringbuffer_t* rb) {
 
     if (rb != 0) {
+#ifdef RINGBUFFER_STATS
+        /* the content is removed just like by reading it */
+        rb->stats.bytesOut += ringbuffer_length(rb);
+        rb->stats.framesOut += rb->nframes;
+#endif
+#ifndef RINGBUFFER_POW2
         rb->len = 0;
+#endif
         rb->iw = 0;
         rb->ir = 0;
+        rb->nframes = 0;
+#ifdef RINGBUFFER_OVERWRITE
+        rb->droppedFrames = 0;
+        rb->droppedBytes = 0;
+#endif
     }
 }
 
@@ -97,101 +339,165 @@ size_t ringbuffer_write(ringbuffer_t* rb, uint8_t* data, size_t len) {
 
         /* don't write more than there is space
          * (assuming len never exceeds size) */
-        size_t space = (size_t)(rb->size - rb->len);
+        size_t space = (size_t)(rb->size - ringbuffer_length(rb));
         if (len > space) {
+            ringbuffer_reject(rb, 1, len - space);
             len = space;
         }
-        rb->len += len;
         lenWritten = len;
 
-        /* assuming write index never exceeds size */
-        size_t tmpLen = (size_t)(rb->size - rb->iw);
-        if (len <= tmpLen) {
-
-            /* copy data until end of buffer */
-            memcpy(rb->buffer + rb->iw, data, len);
+        ringbuffer_copy_to(rb, ringbuffer_pos(rb, rb->iw), data, len);
+        ringbuffer_advance_write(rb, len);
+    }
 
-            /* advance write index */
-            rb->iw += len;
-            if (len == tmpLen) {
-                /* here: rb->iw == rb->size, so wrap write index */
-                rb->iw = 0;
-            }
+    return lenWritten;
+}
 
-        } else {
 
-            /* copy data until end of buffer */
-            memcpy(rb->buffer + rb->iw, data, tmpLen);
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_read(ringbuffer_t* rb, uint8_t* data, size_t len) {
 
-            /* write index implicitly wrapped */
-            rb->iw = len - tmpLen;
+    /* the number of bytes actually read from ring buffer */
+    size_t lenRead = 0;
 
-            /* copy remaining data to beginning of buffer */
-            memcpy(rb->buffer, data + tmpLen, rb->iw);
+    if (rb != 0 && data != 0) {
 
+        /* don't read more than there is data */
+        size_t avail = ringbuffer_length(rb);
+        if (len > avail) {
+#ifdef RINGBUFFER_STATS
+            ++rb->stats.shortReads;
+#endif
+            len = avail;
         }
+        lenRead = len;
+
+        ringbuffer_copy_from(rb, ringbuffer_pos(rb, rb->ir), data, len);
+        ringbuffer_advance_read(rb, len);
     }
 
-    return lenWritten;
+    return lenRead;
 }
 
 
 /*
  * ___________________________________________________________________________
  */
-size_t ringbuffer_read(ringbuffer_t* rb, uint8_t* data, size_t len) {
+size_t ringbuffer_read_memory(ringbuffer_t* rb, uint8_t** data, size_t len) {
 
     /* the number of bytes actually read from ring buffer */
     size_t lenRead = 0;
 
     if (rb != 0 && data != 0) {
 
-        /* don't read more than there is data */
-        if (len > rb->len) {
-            len = rb->len;
+        size_t pos = ringbuffer_pos(rb, rb->ir);
+
+        /* don't read more than there is data ... */
+        size_t avail = ringbuffer_length(rb);
+        if (len > avail) {
+            len = avail;
+        }
+
+        /* ... or beyond the end of the buffer */
+        size_t tmpLen = ringbuffer_contiguous(rb, pos);
+        if (len > tmpLen) {
+            len = tmpLen;
         }
-        rb->len -= len;
+
+        *data = rb->buffer + pos;
         lenRead = len;
 
-        /* assuming read index never exceeds size */
-        size_t tmpLen = (size_t)(rb->size - rb->ir);
-        if (len <= tmpLen) {
+        ringbuffer_advance_read(rb, len);
+    }
 
-            /* copy data until end of buffer */
-            memcpy(data, rb->buffer + rb->ir, len);
+    return lenRead;
+}
 
-            /* advance read index */
-            rb->ir += len;
-            if (len == tmpLen) {
-                /* here: rb->ir == rb->size, so wrap read index */
-                rb->ir = 0;
-            }
 
-        } else {
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_reserve(ringbuffer_t* rb, ringbuffer_span_t span[2],
+        size_t len) {
 
-            /* copy data until end of buffer (assuming
-             * write index never exceeds size) */
-            memcpy(data, rb->buffer + rb->ir, tmpLen);
+    /* the number of bytes actually reserved in ring buffer */
+    size_t lenReserved = 0;
 
-            /* read index implicitly wrapped */
-            rb->ir = len - tmpLen;
+    if (rb != 0 && span != 0) {
+
+        /* don't reserve more than there is space
+         * (assuming len never exceeds size) */
+        size_t space = (size_t)(rb->size - ringbuffer_length(rb));
+        if (len > space) {
+            len = space;
+        }
+        lenReserved = len;
+
+        ringbuffer_split(rb, ringbuffer_pos(rb, rb->iw), span, len);
+    }
+
+    return lenReserved;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_commit(ringbuffer_t* rb, size_t len) {
 
-            /* copy remaining data to beginning of buffer */
-            memcpy(data + tmpLen, rb->buffer, rb->ir);
+    /* the number of bytes actually committed to ring buffer */
+    size_t lenCommitted = 0;
 
+    if (rb != 0) {
+
+        /* don't commit more than there is space
+         * (assuming len never exceeds size) */
+        size_t space = (size_t)(rb->size - ringbuffer_length(rb));
+        if (len > space) {
+            len = space;
         }
+        lenCommitted = len;
+
+        ringbuffer_advance_write(rb, len);
     }
 
-    return lenRead;
+    return lenCommitted;
 }
 
 
 /*
  * ___________________________________________________________________________
  */
-size_t ringbuffer_read_memory(ringbuffer_t* rb, uint8_t** data, size_t len) {
+size_t ringbuffer_peek(ringbuffer_t* rb, ringbuffer_span_t span[2],
+        size_t len) {
+
+    /* the number of bytes actually accessible in ring buffer */
+    size_t lenPeeked = 0;
+
+    if (rb != 0 && span != 0) {
+
+        /* don't peek at more than there is data */
+        size_t avail = ringbuffer_length(rb);
+        if (len > avail) {
+            len = avail;
+        }
+        lenPeeked = len;
+
+        ringbuffer_split(rb, ringbuffer_pos(rb, rb->ir), span, len);
+    }
 
-	return 0;
+    return lenPeeked;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_consume(ringbuffer_t* rb, size_t len) {
+
+    return ringbuffer_discard(rb, len);
 }
 
 
@@ -206,31 +512,39 @@ size_t ringbuffer_sniff(ringbuffer_t* rb, uint8_t* data, size_t len) {
     if (rb != 0 && data != 0) {
 
         /* don't read more than there is data */
-        if (len > rb->len) {
-            len = rb->len;
+        size_t avail = ringbuffer_length(rb);
+        if (len > avail) {
+            len = avail;
         }
         lenSniffed = len;
 
-        /* assuming read index never exceeds size */
-        size_t tmpLen = (size_t)(rb->size - rb->ir);
-        if (len <= tmpLen) {
+        ringbuffer_copy_from(rb, ringbuffer_pos(rb, rb->ir), data, len);
+    }
 
-            /* copy data until end of buffer */
-            memcpy(data, rb->buffer + rb->ir, len);
+    return lenSniffed;
+}
 
-        } else {
 
-            /* copy data until end of buffer (assuming
-             * write index never exceeds size) */
-            memcpy(data, rb->buffer + rb->ir, tmpLen);
+/*
+ * ___________________________________________________________________________
+ */
+uint8_t* ringbuffer_sniff_memory(ringbuffer_t* rb, size_t offset, size_t len) {
+
+    /* pointer to the content requested */
+    uint8_t* data = 0;
+
+    if (rb != 0 && offset + len <= ringbuffer_length(rb)) {
 
-            /* copy remaining data to beginning of buffer */
-            memcpy(data + tmpLen, rb->buffer, len - tmpLen);
+        size_t pos = ringbuffer_pos(rb, rb->ir + offset);
 
+        /* the number of contiguous bytes (until end of buffer) */
+        size_t tmpLen = ringbuffer_contiguous(rb, pos);
+        if (len <= tmpLen) {
+            data = rb->buffer + pos;
         }
     }
 
-    return lenSniffed;
+    return data;
 }
 
 
@@ -247,11 +561,12 @@ size_t ringbuffer_sniff_offset(
 
         /* vLen is the "virtual" length of the ring buffer's
          *  content after considering data to disregard (offset) */
-        size_t vLen = rb->len;
+        size_t vLen = ringbuffer_length(rb);
         if (offset < vLen) {
             vLen -= offset;
         } else {
             vLen = 0;
+            offset = 0;
         }
 
         /* don't read more than there is data */
@@ -262,28 +577,7 @@ size_t ringbuffer_sniff_offset(
 
         /* the "virtual" read index of the ring buffer's
          * after considering data to disregard (offset) */
-        size_t vir = rb->ir + offset;
-        if (vir >= rb->size) {
-            vir -= rb->size;
-        }
-
-        /* assuming read index never exceeds size */
-        size_t tmpLen = (size_t)(rb->size - vir);
-        if (len <= tmpLen) {
-
-            /* copy data until end of buffer */
-            memcpy(data, rb->buffer + vir, len);
-
-        } else {
-
-            /* copy data until end of buffer (assuming
-             * write index never exceeds size) */
-            memcpy(data, rb->buffer + vir, tmpLen);
-
-            /* copy remaining data to beginning of buffer */
-            memcpy(data + tmpLen, rb->buffer, len - tmpLen);
-
-        }
+        ringbuffer_copy_from(rb, ringbuffer_pos(rb, rb->ir + offset), data, len);
     }
 
     return lenSniffed;
@@ -301,32 +595,191 @@ size_t ringbuffer_discard(ringbuffer_t* rb, size_t len) {
     if (rb != 0) {
 
         /* don't discard more than there is data */
-        if (len > rb->len) {
-            len = rb->len;
+        size_t avail = ringbuffer_length(rb);
+        if (len > avail) {
+            len = avail;
         }
-        rb->len -= len;
         lenDiscarded = len;
 
-        /* assuming read index never exceeds size */
-        size_t tmpLen = (size_t)(rb->size - rb->ir);
-        if (len <= tmpLen) {
+        ringbuffer_advance_read(rb, len);
+    }
 
-            /* advance read index */
-            rb->ir += len;
-            if (len == tmpLen) {
-                /* here: rb->ir == rb->size, so wrap read index */
-                rb->ir = 0;
-            }
+    return lenDiscarded;
+}
 
-        } else {
 
-            /* read index implicitly wrapped */
-            rb->ir = len - tmpLen;
+/*
+ * Function to return the number of bytes needed to prefix a frame of length
+ * len with its length (0 if len cannot be represented)
+ * ___________________________________________________________________________
+ */
+static inline size_t ringbuffer_prefix_size(size_t len) {
+
+#ifdef RINGBUFFER_PREFIX_WIDTH
+
+    return (len <= RINGBUFFER_PREFIX_LEN_MAX) ? RINGBUFFER_PREFIX_WIDTH : 0;
+
+#else
+
+    /* 7 bits per byte */
+    size_t n = 1;
+    while (len >= 0x80) {
+        len >>= 7;
+        ++n;
+    }
+    return n;
+
+#endif
+}
+
+
+/*
+ * Function to encode the length prefix of a frame of length len. Returns
+ * the number of bytes of the prefix
+ * ___________________________________________________________________________
+ */
+static inline size_t ringbuffer_encode_prefix(uint8_t* prefix, size_t len) {
+
+    size_t n = 0;
+
+#ifdef RINGBUFFER_PREFIX_WIDTH
+    /* little-endian */
+    for (n = 0; n < RINGBUFFER_PREFIX_WIDTH; ++n) {
+        prefix[n] = (uint8_t)len;
+        len >>= 8;
+    }
+#else
+    /* unsigned LEB128 */
+    while (len >= 0x80) {
+        prefix[n++] = (uint8_t)(len | 0x80);
+        len >>= 7;
+    }
+    prefix[n++] = (uint8_t)len;
+#endif
+
+    return n;
+}
+
+
+/*
+ * Function to write the length prefix of a frame of length len (the space
+ * has to be checked before). Returns the number of bytes written
+ * ___________________________________________________________________________
+ */
+static size_t ringbuffer_put_prefix(ringbuffer_t* rb, size_t len) {
+
+    uint8_t prefix[RINGBUFFER_PREFIX_SIZE_MAX];
+
+    return ringbuffer_write(rb, prefix, ringbuffer_encode_prefix(prefix, len));
+}
+
+
+/*
+ * Function to read the length prefix of a frame starting at offset without
+ * removing it. Returns the size of the prefix and sets *len to the length of
+ * the frame, or returns 0 if there is no (complete) frame
+ * ___________________________________________________________________________
+ */
+static size_t ringbuffer_get_prefix(
+        ringbuffer_t* rb, size_t offset, size_t* len) {
+
+    uint8_t prefix[RINGBUFFER_PREFIX_SIZE_MAX];
+    size_t lenPrefix = 0;
+    size_t length = 0;
+    size_t i;
+
+    size_t n = ringbuffer_sniff_offset(rb, offset, prefix, sizeof(prefix));
 
+#ifdef RINGBUFFER_PREFIX_WIDTH
+    if (n == RINGBUFFER_PREFIX_WIDTH) {
+        /* little-endian */
+        for (i = RINGBUFFER_PREFIX_WIDTH; i > 0; --i) {
+            length = (length << 8) | prefix[i - 1];
+        }
+        lenPrefix = RINGBUFFER_PREFIX_WIDTH;
+    }
+#else
+    for (i = 0; i < n; ++i) {
+        length |= (size_t)(prefix[i] & 0x7F) << (7 * i);
+        if ((prefix[i] & 0x80) == 0) {
+            lenPrefix = i + 1;
+            break;
         }
     }
+#endif
+
+    /* the frame has to be complete (here: offset + lenPrefix <= len) */
+    if (lenPrefix == 0
+            || length > ringbuffer_length(rb) - offset - lenPrefix) {
+        lenPrefix = 0;
+    } else {
+        *len = length;
+    }
 
-    return lenDiscarded;
+    return lenPrefix;
+}
+
+
+#ifdef RINGBUFFER_OVERWRITE
+
+/*
+ * Function to return the free space plus the space taken by the oldest
+ * frames as far as they would have to be evicted to make room for len
+ * bytes (i.e. at least len unless not enough frames can be evicted)
+ * ___________________________________________________________________________
+ */
+static size_t ringbuffer_get_room(ringbuffer_t* rb, size_t len) {
+
+    size_t space = (size_t)(rb->size - ringbuffer_length(rb));
+    size_t offset = 0;
+    size_t nframes = 0;
+    size_t lenFrame = 0;
+    size_t lenPrefix;
+
+    /* whole frames only (stop once no frames are left, as any other
+     * content cannot be told apart from a frame prefix) */
+    while (space + offset < len && nframes < rb->nframes
+            && (lenPrefix = ringbuffer_get_prefix(rb, offset, &lenFrame)) != 0) {
+        offset += lenPrefix + lenFrame;
+        ++nframes;
+    }
+
+    return space + offset;
+}
+
+#endif
+
+
+/*
+ * Function to check whether len bytes fit in. With overwriting enabled,
+ * the oldest frames are evicted if (and only if) that makes room for them.
+ * Returns non-zero if the bytes fit in
+ * ___________________________________________________________________________
+ */
+static int ringbuffer_make_room(ringbuffer_t* rb, size_t len) {
+
+    /* assuming len never exceeds size */
+    size_t space = (size_t)(rb->size - ringbuffer_length(rb));
+
+#ifdef RINGBUFFER_OVERWRITE
+    if (rb->overwrite != 0 && len > space && ringbuffer_get_room(rb, len) >= len) {
+
+        size_t lenFrame = 0;
+        size_t lenPrefix;
+
+        /* evict the oldest frames (known to make room) */
+        while (len > space) {
+            lenPrefix = ringbuffer_get_prefix(rb, 0, &lenFrame);
+            ringbuffer_advance_read(rb, lenPrefix + lenFrame);
+            space += lenPrefix + lenFrame;
+            ringbuffer_remove_frames(rb, 1);
+            ++rb->droppedFrames;
+            rb->droppedBytes += lenFrame;
+        }
+    }
+#endif
+
+    return len <= space;
 }
 
 
@@ -341,15 +794,18 @@ size_t ringbuffer_write_frame(ringbuffer_t* rb, uint8_t* frame, size_t len) {
     if (rb != 0) {
 
         /* only write frame if there is enough space for
-         * the full frame(assuming len never exceeds size) */
-        size_t space = (size_t)(rb->size - rb->len);
-        if ((len + sizeof(size_t)) <= space) {
+         * the full frame (assuming len never exceeds size) */
+        size_t lenPrefix = ringbuffer_prefix_size(len);
+        if (lenPrefix != 0 && ringbuffer_make_room(rb, len + lenPrefix)) {
 
             /* prepend and write frame length */
-            ringbuffer_write(rb, (uint8_t*)&len, sizeof(size_t));
+            ringbuffer_put_prefix(rb, len);
 
             /* write the actual frame */
             lenWritten = ringbuffer_write(rb, frame, len);
+            ringbuffer_add_frames(rb, 1);
+        } else {
+            ringbuffer_reject(rb, 1, len);
         }
     }
 
@@ -368,20 +824,23 @@ size_t ringbuffer_read_frame(ringbuffer_t* rb, uint8_t* frame, size_t len) {
     if (rb != 0) {
 
         size_t lenHeader = 0;
-        
-        if (ringbuffer_sniff(rb, (uint8_t*)&lenHeader, sizeof(size_t))
-                == sizeof(size_t)) {
-
-            if (lenHeader + sizeof(size_t) <= rb->len
-                    && len >= lenHeader) {
-
-                /* discard header (we already read it) */
-                ringbuffer_discard(rb, sizeof(size_t));
-                
-                /* the actual frame */
-                lenRead = ringbuffer_read(rb, frame, lenHeader);
-            }
+        size_t lenPrefix = ringbuffer_get_prefix(rb, 0, &lenHeader);
+
+        if (lenPrefix != 0 && len >= lenHeader) {
+
+            /* discard prefix (we already read it) */
+            ringbuffer_discard(rb, lenPrefix);
+
+            /* the actual frame */
+            lenRead = ringbuffer_read(rb, frame, lenHeader);
+            ringbuffer_remove_frames(rb, 1);
+        }
+#ifdef RINGBUFFER_STATS
+        else if (lenPrefix != 0) {
+            /* the frame does not fit into len bytes */
+            ++rb->stats.shortReads;
         }
+#endif
     }
 
     return lenRead;
@@ -398,17 +857,15 @@ size_t ringbuffer_sniff_frame(ringbuffer_t* rb, uint8_t* frame, size_t len) {
 
     if (rb != 0) {
 
-    	/* length of frame read from header in ring buffer */
+        /* length of frame read from prefix in ring buffer */
         size_t lenHeader = 0;
-        
-        if ((ringbuffer_sniff(rb, (uint8_t*)&lenHeader,
-        		sizeof(size_t)) == sizeof(size_t))
-        				&& (lenHeader + sizeof(size_t) <= rb->len)
-						&& (len >= lenHeader)) {
-                
-			/* sniff the actual frame */
-			lenSniffed = ringbuffer_sniff_offset(
-					rb, sizeof(size_t), frame, lenHeader);
+        size_t lenPrefix = ringbuffer_get_prefix(rb, 0, &lenHeader);
+
+        if (lenPrefix != 0 && len >= lenHeader) {
+
+            /* sniff the actual frame */
+            lenSniffed = ringbuffer_sniff_offset(
+                    rb, lenPrefix, frame, lenHeader);
         }
     }
 
@@ -424,19 +881,39 @@ size_t ringbuffer_sniff_frame_length(ringbuffer_t* rb) {
     /* the length of the next frame in the ring buffer */
     size_t length = 0;
 
-    if (rb != 0) {
-        if ((ringbuffer_sniff(rb, (uint8_t*)&length,
-        		sizeof(size_t)) != sizeof(size_t))
-        				|| (length + sizeof(size_t) > rb->len)) {
-        	/* no frame or invalid frame */
-        	length = 0;
-        }
+    if (rb != 0 && ringbuffer_get_prefix(rb, 0, &length) == 0) {
+        /* no frame or invalid frame */
+        length = 0;
     }
 
     return length;
 }
 
 
+/*
+ * ___________________________________________________________________________
+ */
+uint8_t* ringbuffer_sniff_frame_memory(ringbuffer_t* rb, size_t* len) {
+
+    /* pointer to the frame */
+    uint8_t* frame = 0;
+
+    if (rb != 0 && len != 0) {
+
+        /* the length of the next frame in the ring buffer */
+        size_t length = 0;
+        size_t lenPrefix = ringbuffer_get_prefix(rb, 0, &length);
+
+        if (lenPrefix != 0) {
+            frame = ringbuffer_sniff_memory(rb, lenPrefix, length);
+            *len = length;
+        }
+    }
+
+    return frame;
+}
+
+
 /*
  * ___________________________________________________________________________
  */
@@ -448,13 +925,13 @@ size_t ringbuffer_discard_frame(ringbuffer_t* rb) {
     if (rb != 0) {
 
         size_t lenHeader = 0;
-        
-        if ((ringbuffer_sniff(rb, (uint8_t*)&lenHeader,
-        		sizeof(size_t)) == sizeof(size_t))
-        				&& ((lenHeader + sizeof(size_t)) <= rb->len)) {
+        size_t lenPrefix = ringbuffer_get_prefix(rb, 0, &lenHeader);
 
-			/* discard frame */
-			lenDiscarded = ringbuffer_discard(rb, lenHeader + sizeof(size_t));
+        if (lenPrefix != 0) {
+
+            /* discard frame */
+            lenDiscarded = ringbuffer_discard(rb, lenPrefix + lenHeader);
+            ringbuffer_remove_frames(rb, 1);
         }
     }
 
@@ -470,30 +947,198 @@ size_t ringbuffer_count_frames(ringbuffer_t* rb) {
     size_t n = 0;
 
     if (rb != 0) {
+        n = rb->nframes;
+    }
+
+    return n;
+}
+
+
+#ifdef RINGBUFFER_OVERWRITE
 
-    	size_t flen;
-
-    	size_t len = rb->len;
-    	size_t offset = 0;
-    	while (len > sizeof(size_t)) {
-    		len -= sizeof(size_t);
-    		if (ringbuffer_sniff_offset(rb, offset, (uint8_t*)&flen, sizeof(size_t))
-    				== sizeof(size_t) && flen <= len) {
-    			/* skip this frame */
-        		len -= flen;
-        		offset += sizeof(size_t) + flen;
-        		++n;
-    		} else {
-    			/* something is wrong */
-    			n = 0;
-    			len = 0;
-    		}
-    	}
+/*
+ * ___________________________________________________________________________
+ */
+void ringbuffer_set_overwrite(ringbuffer_t* rb, int enable) {
+
+    if (rb != 0) {
+        rb->overwrite = (enable != 0) ? 1 : 0;
+    }
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_get_dropped(ringbuffer_t* rb, size_t* bytes) {
+
+    size_t n = 0;
+
+    if (rb != 0) {
+        n = rb->droppedFrames;
+        if (bytes != 0) {
+            *bytes = rb->droppedBytes;
+        }
     }
 
     return n;
 }
 
+#endif
+
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_write_frames(ringbuffer_t* rb,
+        const ringbuffer_span_t* frames, size_t n) {
+
+    /* the number of frames written to ring buffer */
+    size_t nWritten = 0;
+
+    if (rb != 0 && frames != 0) {
+
+        uint8_t prefix[RINGBUFFER_PREFIX_SIZE_MAX];
+        size_t space = (size_t)(rb->size - ringbuffer_length(rb));
+        size_t total = 0;
+        size_t lenPrefix;
+
+        /* the first frame to write */
+        size_t first = 0;
+
+#ifdef RINGBUFFER_OVERWRITE
+        if (rb->overwrite != 0) {
+
+            /* the newest frames matter: write the longest tail of the batch
+             * that fits in after evicting the oldest frames as needed ... */
+            space = ringbuffer_get_room(rb, rb->size);
+            first = n;
+            while (first > 0) {
+                lenPrefix = ringbuffer_prefix_size(frames[first - 1].len);
+                if (lenPrefix == 0 || frames[first - 1].len + lenPrefix
+                        > space - total) {
+                    break;
+                }
+                total += lenPrefix + frames[first - 1].len;
+                --first;
+            }
+            nWritten = n - first;
+
+            /* ... (evicting all older frames as well if leading frames of
+             * the batch are dropped, so that no frame outlives a newer
+             * one) ... */
+            ringbuffer_make_room(rb, (first > 0) ? space : total);
+
+            /* ... and drop the leading frames (refusing the last one not
+             * fitting in if it never would) */
+            size_t i;
+            for (i = 0; i < first; ++i) {
+                lenPrefix = ringbuffer_prefix_size(frames[i].len);
+                if (i + 1 == first && (lenPrefix == 0
+                        || frames[i].len + lenPrefix > rb->size)) {
+                    ringbuffer_reject(rb, 1, frames[i].len);
+                } else {
+                    ++rb->droppedFrames;
+                    rb->droppedBytes += frames[i].len;
+                }
+            }
+
+        } else
+#endif
+        {
+            /* determine the frames that fit in (in a single pass) */
+            while (nWritten < n) {
+                lenPrefix = ringbuffer_prefix_size(frames[nWritten].len);
+                if (lenPrefix == 0 || frames[nWritten].len + lenPrefix
+                        > space - total) {
+                    break;
+                }
+                total += lenPrefix + frames[nWritten].len;
+                ++nWritten;
+            }
+
+#ifdef RINGBUFFER_STATS
+            size_t i;
+            for (i = nWritten; i < n; ++i) {
+                ringbuffer_reject(rb, 1, frames[i].len);
+            }
+#endif
+        }
+
+        /* copy them behind the write index ... */
+        size_t offset = 0;
+        size_t i;
+        for (i = first; i < first + nWritten; ++i) {
+            lenPrefix = ringbuffer_encode_prefix(prefix, frames[i].len);
+            ringbuffer_copy_to(rb, ringbuffer_pos(rb, rb->iw + offset),
+                    prefix, lenPrefix);
+            offset += lenPrefix;
+            ringbuffer_copy_to(rb, ringbuffer_pos(rb, rb->iw + offset),
+                    frames[i].data, frames[i].len);
+            offset += frames[i].len;
+        }
+
+        /* ... and advance it once */
+        ringbuffer_advance_write(rb, total);
+        ringbuffer_add_frames(rb, nWritten);
+    }
+
+    return nWritten;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_read_frames(ringbuffer_t* rb, ringbuffer_span_t* frames,
+        size_t n, uint8_t* buf, size_t len) {
+
+    /* the number of frames read from ring buffer */
+    size_t nRead = 0;
+
+    if (rb != 0 && frames != 0 && buf != 0) {
+
+        /* the bytes of the ring buffer and of buf used so far */
+        size_t offset = 0;
+        size_t used = 0;
+
+        while (nRead < n) {
+
+            size_t lenFrame = 0;
+            size_t lenPrefix = ringbuffer_get_prefix(rb, offset, &lenFrame);
+
+            if (lenPrefix == 0) {
+                /* no more frames */
+                break;
+            }
+
+            if (lenFrame > len - used) {
+                /* budget exhausted: the frame does not fit into buf */
+#ifdef RINGBUFFER_STATS
+                ++rb->stats.shortReads;
+#endif
+                break;
+            }
+
+            ringbuffer_copy_from(rb, ringbuffer_pos(rb, rb->ir + offset
+                    + lenPrefix), buf + used, lenFrame);
+
+            frames[nRead].data = buf + used;
+            frames[nRead].len = lenFrame;
+
+            offset += lenPrefix + lenFrame;
+            used += lenFrame;
+            ++nRead;
+        }
+
+        /* remove all frames read at once */
+        ringbuffer_advance_read(rb, offset);
+        ringbuffer_remove_frames(rb, nRead);
+    }
+
+    return nRead;
+}
+
 
 /*
  * ___________________________________________________________________________
@@ -506,22 +1151,31 @@ size_t ringbuffer_write_frame_with_header(ringbuffer_t* rb,
 
     if (rb != 0) {
 
+        /* the total frame length including header */
+        size_t len = hlen + flen;
+        size_t lenPrefix = ringbuffer_prefix_size(len);
+
         /* only write frame if there is enough space for
          * the full frame (assuming len never exceeds size) */
-        if ((sizeof(size_t) + hlen + flen) <= (size_t)(rb->size - rb->len)) {
-
-        	/* the total frame length including header */
-        	size_t len = hlen + flen;
-
-            /* prepend and write total frame length */
-            n += ringbuffer_write(rb, (uint8_t*)&len, sizeof(size_t));
-
-            /* write header */
-            n += ringbuffer_write(rb, header, hlen);
-
-            /* write frame */
-            n += ringbuffer_write(rb, frame, flen);
-
+        if (lenPrefix != 0 && ringbuffer_make_room(rb, lenPrefix + len)) {
+
+            uint8_t prefix[RINGBUFFER_PREFIX_SIZE_MAX];
+            lenPrefix = ringbuffer_encode_prefix(prefix, len);
+
+            /* prepend total frame length, header and frame ... */
+            ringbuffer_copy_to(rb, ringbuffer_pos(rb, rb->iw),
+                    prefix, lenPrefix);
+            ringbuffer_copy_to(rb, ringbuffer_pos(rb, rb->iw + lenPrefix),
+                    header, hlen);
+            ringbuffer_copy_to(rb, ringbuffer_pos(rb, rb->iw + lenPrefix
+                    + hlen), frame, flen);
+
+            /* ... and advance write index once */
+            n = lenPrefix + len;
+            ringbuffer_advance_write(rb, n);
+            ringbuffer_add_frames(rb, 1);
+        } else {
+            ringbuffer_reject(rb, 1, len);
         }
     }
 
@@ -542,23 +1196,20 @@ size_t ringbuffer_read_frame_with_header(ringbuffer_t* rb,
 
     	/* the length of the next frame in the ring buffer */
         size_t len = 0;
+        size_t lenPrefix = ringbuffer_get_prefix(rb, 0, &len);
 
-        if (ringbuffer_sniff(rb, (uint8_t*)&len, sizeof(size_t))
-                == sizeof(size_t)) {
-
-            if (len + sizeof(size_t) <= rb->len
-            		&& (hlen + max_flen) >= len) {
+        if (lenPrefix != 0 && len >= hlen && (hlen + max_flen) >= len) {
 
-                /* discard length (we already know it) */
-                ringbuffer_discard(rb, sizeof(size_t));
+            /* discard prefix (we already know the length) */
+            ringbuffer_discard(rb, lenPrefix);
 
-                /* the header */
-                ringbuffer_read(rb, header, hlen);
+            /* the header */
+            ringbuffer_read(rb, header, hlen);
 
-                /* the frame */
-                n = ringbuffer_read(rb, frame, len - hlen);
+            /* the frame */
+            n = ringbuffer_read(rb, frame, len - hlen);
 
-            }
+            ringbuffer_remove_frames(rb, 1);
         }
     }
 
@@ -579,23 +1230,170 @@ size_t ringbuffer_sniff_frame_with_header(ringbuffer_t* rb,
 
     	/* the length of the next frame in the ring buffer */
         size_t len = 0;
+        size_t lenPrefix = ringbuffer_get_prefix(rb, 0, &len);
 
-        if (ringbuffer_sniff(rb, (uint8_t*)&len, sizeof(size_t))
-                == sizeof(size_t)) {
+        if (lenPrefix != 0 && len >= hlen && (hlen + max_flen) >= len) {
 
-            if (len + sizeof(size_t) <= rb->len
-            		&& (hlen + max_flen) >= len) {
+            /* the header */
+            ringbuffer_sniff_offset(rb, lenPrefix, header, hlen);
 
-                /* the header */
-                ringbuffer_sniff_offset(rb, sizeof(size_t), header, hlen);
+            /* the frame */
+            n = ringbuffer_sniff_offset(rb, lenPrefix + hlen,
+                    frame, len - hlen);
+        }
+    }
 
-                /* the frame */
-                n = ringbuffer_sniff_offset(rb, sizeof(size_t) + hlen,
-                		frame, len - hlen);
+    return n;
+}
 
+
+#ifdef RINGBUFFER_STATS
+
+/*
+ * ___________________________________________________________________________
+ */
+void ringbuffer_get_stats(ringbuffer_t* rb, ringbuffer_stats_t* stats) {
+
+    if (rb != 0 && stats != 0) {
+        *stats = rb->stats;
+    }
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+void ringbuffer_reset_stats(ringbuffer_t* rb) {
+
+    if (rb != 0) {
+        memset(&rb->stats, 0, sizeof(rb->stats));
+        rb->stats.peakLen = ringbuffer_length(rb);
+    }
+}
+
+#endif
+
+
+#ifdef RINGBUFFER_POSIX
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_writev_frame(ringbuffer_t* rb,
+        const struct iovec* iov, int iovcnt) {
+
+    /* the number of bytes from frame written to ring buffer */
+    size_t lenWritten = 0;
+
+    if (rb != 0 && (iov != 0 || iovcnt == 0)) {
+
+        /* the total frame length */
+        size_t len = 0;
+        int i;
+        for (i = 0; i < iovcnt; ++i) {
+            len += iov[i].iov_len;
+        }
+
+        /* only write frame if there is enough space for
+         * the full frame (assuming len never exceeds size) */
+        size_t lenPrefix = ringbuffer_prefix_size(len);
+        if (lenPrefix != 0 && ringbuffer_make_room(rb, lenPrefix + len)) {
+
+            uint8_t prefix[RINGBUFFER_PREFIX_SIZE_MAX];
+            lenPrefix = ringbuffer_encode_prefix(prefix, len);
+
+            /* prepend frame length and gather the parts ... */
+            ringbuffer_copy_to(rb, ringbuffer_pos(rb, rb->iw),
+                    prefix, lenPrefix);
+            size_t offset = lenPrefix;
+            for (i = 0; i < iovcnt; ++i) {
+                ringbuffer_copy_to(rb, ringbuffer_pos(rb, rb->iw + offset),
+                        (const uint8_t*)iov[i].iov_base, iov[i].iov_len);
+                offset += iov[i].iov_len;
             }
+
+            /* ... and advance write index once */
+            ringbuffer_advance_write(rb, offset);
+            ringbuffer_add_frames(rb, 1);
+            lenWritten = len;
+        } else {
+            ringbuffer_reject(rb, 1, len);
         }
     }
 
-    return n;
+    return lenWritten;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+ssize_t ringbuffer_read_from_fd(ringbuffer_t* rb, int fd, size_t len) {
+
+    /* the number of bytes read from fd (or -1) */
+    ssize_t lenRead = -1;
+
+    if (rb != 0) {
+
+        ringbuffer_span_t span[2];
+        struct iovec iov[2];
+
+        /* read directly into the free space */
+        if (ringbuffer_reserve(rb, span, len) == 0) {
+
+            lenRead = 0;
+
+        } else {
+
+            iov[0].iov_base = span[0].data;
+            iov[0].iov_len = span[0].len;
+            iov[1].iov_base = span[1].data;
+            iov[1].iov_len = span[1].len;
+
+            lenRead = readv(fd, iov, span[1].len > 0 ? 2 : 1);
+            if (lenRead > 0) {
+                ringbuffer_commit(rb, (size_t)lenRead);
+            }
+        }
+    }
+
+    return lenRead;
 }
+
+
+/*
+ * ___________________________________________________________________________
+ */
+ssize_t ringbuffer_write_to_fd(ringbuffer_t* rb, int fd, size_t len) {
+
+    /* the number of bytes written to fd (or -1) */
+    ssize_t lenWritten = -1;
+
+    if (rb != 0) {
+
+        ringbuffer_span_t span[2];
+        struct iovec iov[2];
+
+        /* write directly from the content */
+        if (ringbuffer_peek(rb, span, len) == 0) {
+
+            lenWritten = 0;
+
+        } else {
+
+            iov[0].iov_base = span[0].data;
+            iov[0].iov_len = span[0].len;
+            iov[1].iov_base = span[1].data;
+            iov[1].iov_len = span[1].len;
+
+            lenWritten = writev(fd, iov, span[1].len > 0 ? 2 : 1);
+            if (lenWritten > 0) {
+                ringbuffer_consume(rb, (size_t)lenWritten);
+            }
+        }
+    }
+
+    return lenWritten;
+}
+
+#endif
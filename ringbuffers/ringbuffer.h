@@ -28,6 +28,83 @@
 #include <stdint.h>
 #include <stddef.h>
 
+/*
+ * Compile-time options (to be defined when compiling ringbuffer.c and the
+ * code using it):
+ *
+ *  RINGBUFFER_POW2  restrict the size to a power of two (ringbuffer_init()
+ *                   rounds down) and use free-running indices masked on
+ *                   access instead of wrapping indices and a separate
+ *                   length, which shortens every read and write. Ring
+ *                   buffers initialized statically must then have a power
+ *                   of two as size as well.
+ *  RINGBUFFER_MIRROR  support ring buffers whose memory is mapped twice back
+ *                   to back (see ringbuffer_mirror.h), such that any
+ *                   region of up to size bytes is contiguous and can be
+ *                   accessed in place without split copies.
+ *  RINGBUFFER_FRAME_PREFIX  the length prefix of frames: 1, 2, 4 or 8 bytes
+ *                   (little-endian, limiting the frame length accordingly),
+ *                   RINGBUFFER_PREFIX_VARINT (unsigned LEB128, i.e. one byte
+ *                   for frames up to 127 bytes) or RINGBUFFER_PREFIX_SIZE_T
+ *                   (sizeof(size_t) bytes, the default)
+ *  RINGBUFFER_POSIX  provide vectored frame writes and direct file
+ *                   descriptor I/O (default: on Unix-like systems)
+ *  RINGBUFFER_OVERWRITE  support an overwrite mode (see
+ *                   ringbuffer_set_overwrite()) in which frames that do not
+ *                   fit in evict the oldest frames instead of being refused,
+ *                   keeping the last size bytes like a flight recorder
+ *  RINGBUFFER_STATS  maintain counters of the traffic, the peak length and
+ *                   refused writes (see ringbuffer_get_stats()); without it,
+ *                   the statistics functions are empty inline functions
+ */
+
+#define RINGBUFFER_PREFIX_SIZE_T    0
+#define RINGBUFFER_PREFIX_VARINT    0xFF
+
+#ifndef RINGBUFFER_FRAME_PREFIX
+    #define RINGBUFFER_FRAME_PREFIX RINGBUFFER_PREFIX_SIZE_T
+#endif
+
+#if !defined(RINGBUFFER_POSIX) && (defined(__unix__) || defined(__APPLE__))
+    #define RINGBUFFER_POSIX
+#endif
+
+#ifdef RINGBUFFER_POSIX
+    #include <sys/types.h>
+    #include <sys/uio.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* statistics of a ring buffer (with RINGBUFFER_STATS) */
+typedef struct {
+
+    /* maximum length of content */
+    size_t peakLen;
+
+    /* number of bytes written and removed (read, consumed, discarded,
+     * evicted or cleared, including frame length prefixes) */
+    size_t bytesIn;
+    size_t bytesOut;
+
+    /* number of frames written and removed */
+    size_t framesIn;
+    size_t framesOut;
+
+    /* number of writes (frames) refused or cut short for lack of space and
+     * the number of bytes not written */
+    size_t rejectedWrites;
+    size_t rejectedBytes;
+
+    /* number of reads returning less than requested (or frames not fitting
+     * into the buffer given) */
+    size_t shortReads;
+
+} ringbuffer_stats_t;
+
 
 typedef struct {
 
@@ -37,18 +114,56 @@ typedef struct {
     /* size of buffer */
     size_t size;
 
+#ifndef RINGBUFFER_POW2
     /* length of content */
     size_t len;
+#endif
 
-    /* writing index */
+    /* writing index (free-running with RINGBUFFER_POW2) */
     size_t iw;
 
-    /* reading index */
+    /* reading index (free-running with RINGBUFFER_POW2) */
     size_t ir;
 
+    /* number of frames (only maintained by the frame functions, which
+     * must therefore not be mixed with plain reads and writes) */
+    size_t nframes;
+
+#ifdef RINGBUFFER_MIRROR
+    /* non-zero if the buffer is followed by a mirror of itself */
+    uint8_t mirrored;
+#endif
+
+#ifdef RINGBUFFER_OVERWRITE
+    /* non-zero if frames evict the oldest frames to make room */
+    uint8_t overwrite;
+
+    /* number of frames evicted ... */
+    size_t droppedFrames;
+
+    /* ... and their total length (without length prefixes) */
+    size_t droppedBytes;
+#endif
+
+#ifdef RINGBUFFER_STATS
+    ringbuffer_stats_t stats;
+#endif
+
 } ringbuffer_t;
 
 
+/* a contiguous region of a ring buffer's memory */
+typedef struct {
+
+    /* pointer to the first byte of the region */
+    uint8_t* data;
+
+    /* length of the region */
+    size_t len;
+
+} ringbuffer_span_t;
+
+
 /* TODO: Add description */
 void ringbuffer_init(ringbuffer_t* rb, uint8_t* mem, size_t memlen);
 
@@ -67,12 +182,43 @@ size_t ringbuffer_write(ringbuffer_t* rb, uint8_t* data, size_t len);
 /* TODO: Add description */
 size_t ringbuffer_read(ringbuffer_t* rb, uint8_t* data, size_t len);
 
-/* TODO: Add description */
+/* Function to read up to len bytes without copying: *data is set to the
+ * bytes in the ring buffer's memory and the number of bytes (up to the end
+ * of the contiguous region) is returned. The bytes are removed from the ring
+ * buffer and remain valid only until the next write */
 size_t ringbuffer_read_memory(ringbuffer_t* rb, uint8_t** data, size_t len);
 
+/* Function to reserve up to len bytes of free space for writing in place
+ * (e.g. by DMA): span[0] and span[1] are set to the (up to two) contiguous
+ * regions in writing order and the total number of bytes reserved is
+ * returned. The bytes become part of the content by ringbuffer_commit() */
+size_t ringbuffer_reserve(ringbuffer_t* rb, ringbuffer_span_t span[2],
+        size_t len);
+
+/* Function to append up to len bytes written in place after
+ * ringbuffer_reserve() to the content. Returns the number of bytes
+ * committed */
+size_t ringbuffer_commit(ringbuffer_t* rb, size_t len);
+
+/* Function to access up to len bytes of content in place: span[0] and
+ * span[1] are set to the (up to two) contiguous regions in reading order and
+ * the total number of bytes is returned. The bytes are removed from the ring
+ * buffer by ringbuffer_consume() */
+size_t ringbuffer_peek(ringbuffer_t* rb, ringbuffer_span_t span[2],
+        size_t len);
+
+/* Function to remove up to len bytes accessed by ringbuffer_peek() (same as
+ * ringbuffer_discard()) */
+size_t ringbuffer_consume(ringbuffer_t* rb, size_t len);
+
 /* TODO: Add description */
 size_t ringbuffer_sniff(ringbuffer_t* rb, uint8_t* data, size_t len);
 
+/* Function to return a pointer to len bytes of content starting at offset
+ * without copying, or 0 if there are less bytes or they are not contiguous
+ * (which never happens for mirrored ring buffers) */
+uint8_t* ringbuffer_sniff_memory(ringbuffer_t* rb, size_t offset, size_t len);
+
 /* TODO: Add description */
 size_t ringbuffer_sniff_offset(
         ringbuffer_t* rb, size_t offset, uint8_t* data, size_t len);
@@ -93,12 +239,53 @@ size_t ringbuffer_sniff_frame(ringbuffer_t* rb, uint8_t* frame, size_t len);
 /* TODO: Add description */
 size_t ringbuffer_sniff_frame_length(ringbuffer_t* rb);
 
+/* Function to return a pointer to the next frame without copying (and its
+ * length in *len), or 0 if there is no frame or it is not contiguous (which
+ * never happens for mirrored ring buffers) */
+uint8_t* ringbuffer_sniff_frame_memory(ringbuffer_t* rb, size_t* len);
+
 /* TODO: Add description */
 size_t ringbuffer_discard_frame(ringbuffer_t* rb);
 
-/* TODO: Add description */
+/* Function to return the number of frames in the ring buffer (in constant
+ * time) */
 size_t ringbuffer_count_frames(ringbuffer_t* rb);
 
+#ifdef RINGBUFFER_OVERWRITE
+
+/* Function to enable (enable != 0) or disable overwriting: whole frames are
+ * then evicted from the reading end until a new frame fits in. Frames
+ * longer than the ring buffer are still refused. Eviction stops once no
+ * frames written by the frame functions are left, so content written
+ * otherwise is kept as long as it is not followed by frames (it cannot be
+ * told apart from frames at the reading end) */
+void ringbuffer_set_overwrite(ringbuffer_t* rb, int enable);
+
+/* Function to return the number of frames evicted since the last
+ * ringbuffer_clear() and to set *bytes (if not 0) to their total length */
+size_t ringbuffer_get_dropped(ringbuffer_t* rb, size_t* bytes);
+
+#endif
+
+
+/* Function to write up to n frames (as far as they fit in, in order) with a
+ * single space check and index update. Returns the number of frames
+ * written. With overwriting enabled, these are the last frames of the batch
+ * (the longest tail fitting in after evicting the oldest frames), while the
+ * leading frames not written are counted as dropped (and evict all older
+ * frames, such that no frame outlives a newer one) */
+size_t ringbuffer_write_frames(ringbuffer_t* rb,
+        const ringbuffer_span_t* frames, size_t n);
+
+/* Function to read up to n frames (as far as they fit into the len bytes of
+ * buf) with a single index update: the frames are copied to buf one after
+ * another and described by frames[]. Returns the number of frames read.
+ * If the oldest frame alone exceeds len, 0 is returned just like for an
+ * empty ring buffer, so polling callers have to tell both apart, e.g. by
+ * ringbuffer_sniff_frame_length() (to provide a larger buf) or
+ * ringbuffer_discard_frame() (to skip the frame) */
+size_t ringbuffer_read_frames(ringbuffer_t* rb, ringbuffer_span_t* frames,
+        size_t n, uint8_t* buf, size_t len);
 
 /* TODO: Add description */
 size_t ringbuffer_write_frame_with_header(ringbuffer_t* rb,
@@ -112,5 +299,55 @@ size_t ringbuffer_read_frame_with_header(ringbuffer_t* rb,
 size_t ringbuffer_sniff_frame_with_header(ringbuffer_t* rb,
 		uint8_t* header, size_t hlen, uint8_t* frame, size_t max_flen);
 
+#ifdef RINGBUFFER_STATS
+
+/* Function to copy the statistics to *stats */
+void ringbuffer_get_stats(ringbuffer_t* rb, ringbuffer_stats_t* stats);
+
+/* Function to reset the statistics (the peak length to the current
+ * length) */
+void ringbuffer_reset_stats(ringbuffer_t* rb);
+
+#else
+
+static inline void ringbuffer_get_stats(
+        ringbuffer_t* rb, ringbuffer_stats_t* stats) {
+    /* (zero-initialized) */
+    static ringbuffer_stats_t zero;
+    (void)rb;
+    if (stats != 0) {
+        *stats = zero;
+    }
+}
+
+static inline void ringbuffer_reset_stats(ringbuffer_t* rb) {
+    (void)rb;
+}
+
+#endif
+
+#ifdef RINGBUFFER_POSIX
+
+/* Function to write a frame gathered from iovcnt parts with a single space
+ * check and index update. Returns the length of the frame written (0 if it
+ * does not fit in) */
+size_t ringbuffer_writev_frame(ringbuffer_t* rb,
+        const struct iovec* iov, int iovcnt);
+
+/* Function to read up to len bytes from fd directly into the ring buffer
+ * (using readv() on the free regions). Returns the number of bytes read,
+ * 0 on end of file or if the ring buffer is full, or -1 on error */
+ssize_t ringbuffer_read_from_fd(ringbuffer_t* rb, int fd, size_t len);
+
+/* Function to write up to len bytes from the ring buffer directly to fd
+ * (using writev() on the content's regions). Returns the number of bytes
+ * written, 0 if the ring buffer is empty, or -1 on error */
+ssize_t ringbuffer_write_to_fd(ringbuffer_t* rb, int fd, size_t len);
+
+#endif
+
+#ifdef __cplusplus
+}
 #endif
 
+#endif
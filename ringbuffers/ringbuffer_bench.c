@@ -0,0 +1,602 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development 
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+/*
+ * Throughput and latency benchmark for the ring buffers, e.g.
+ *
+ *  gcc -O2 -pthread -o ringbuffer_bench ringbuffer_bench.c ringbuffer.c \
+ *          ringbuffer_spsc.c ringbuffer_mpmc.c
+ *
+ * (with the same RINGBUFFER_* options as the code to be measured). Sweeps
+ * frame sizes from 1 byte to 64 KB over several buffer sizes and two wrap
+ * patterns, both single-threaded for ringbuffer_t (plain, frame, batched
+ * frame and frame-with-header functions) and with a producer and a consumer
+ * thread on two cores for ringbuffer_t (frame functions guarded by a mutex),
+ * ringbuffer_spsc_t and ringbuffer_mpmc_t. The latter also report
+ * percentiles of the enqueue-to-dequeue latency.
+ *
+ * Results are printed as CSV (one line per run, preceded by '#' comment
+ * lines describing the configuration) to be collected and compared across
+ * revisions. Only frames accepted by the ring buffer and read back count
+ * towards the throughput; the 'refused' column holds the number of writes
+ * the ring buffer refused (dropped in single-threaded runs, retried by the
+ * producer thread otherwise). Options:
+ *
+ *  -q  quick run (a sixteenth of the default volume)
+ *  -v  volume in MB per run (default: 64)
+ */
+
+/* for pthread_setaffinity_np() */
+#define _GNU_SOURCE
+
+#include "ringbuffer.h"
+#include "ringbuffer_spsc.h"
+#include "ringbuffer_mpmc.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+
+/* frames per batch for ringbuffer_write_frames() / ringbuffer_read_frames() */
+#define BENCH_BATCH         16
+
+/* payload of an MPMC cell */
+#define BENCH_CELL_SIZE     64
+
+/* latency histogram: 16 linear sub-buckets per power of two */
+#define BENCH_HIST_SUB      4
+#define BENCH_HIST_SIZE     ((64 - BENCH_HIST_SUB + 1) << BENCH_HIST_SUB)
+
+
+static const size_t frameSizes[] = {
+    1, 4, 16, 64, 256, 1024, 4096, 16384, 65536 };
+
+static const size_t bufferSizes[] = {
+    4096, 65536, 1048576, 4194304 };
+
+/* wrap patterns: start empty (write and read alternate at the same
+ * position) or with an odd backlog of half the buffer (frames straddle the
+ * end of the buffer regularly) */
+static const char* patterns[] = { "empty", "backlog" };
+
+/* the number of bytes to move per run */
+static size_t volume = (size_t)64 << 20;
+
+
+typedef struct {
+
+    /* number of samples per bucket */
+    uint64_t counts[BENCH_HIST_SIZE];
+
+    /* total number of samples */
+    uint64_t total;
+
+} bench_hist_t;
+
+
+/*
+ * ___________________________________________________________________________
+ */
+static uint64_t bench_now(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+static size_t bench_hist_index(uint64_t value) {
+
+    if (value < (1u << BENCH_HIST_SUB)) {
+        return (size_t)value;
+    }
+
+    /* the position of the most significant bit ... */
+    int msb = 63 - __builtin_clzll(value);
+
+    /* ... and the next bits below it */
+    return ((size_t)(msb - BENCH_HIST_SUB + 1) << BENCH_HIST_SUB)
+            + (size_t)((value >> (msb - BENCH_HIST_SUB))
+                    & ((1u << BENCH_HIST_SUB) - 1));
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+static uint64_t bench_hist_value(size_t index) {
+
+    if (index < (1u << BENCH_HIST_SUB)) {
+        return index;
+    }
+
+    /* the lower bound of the bucket */
+    int msb = (int)(index >> BENCH_HIST_SUB) + BENCH_HIST_SUB - 1;
+    uint64_t sub = index & ((1u << BENCH_HIST_SUB) - 1);
+
+    return ((uint64_t)1 << msb) | (sub << (msb - BENCH_HIST_SUB));
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+static uint64_t bench_hist_percentile(bench_hist_t* hist, double p) {
+
+    uint64_t rank = (uint64_t)(p * (double)hist->total);
+    uint64_t sum = 0;
+    size_t i;
+
+    for (i = 0; i < BENCH_HIST_SIZE; ++i) {
+        sum += hist->counts[i];
+        if (sum > rank) {
+            return bench_hist_value(i);
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+static void bench_report(const char* ring, const char* api, size_t fsize,
+        size_t bsize, const char* pattern, int threads, size_t nframes,
+        size_t refused, uint64_t ns, bench_hist_t* hist) {
+
+    double s = (double)ns / 1e9;
+
+    printf("%s,%s,%zu,%zu,%s,%d,%zu,%zu,%.0f,%.0f", ring, api, fsize, bsize,
+            pattern, threads, nframes, refused, (double)(nframes * fsize) / s,
+            (double)nframes / s);
+
+    if (hist != 0 && hist->total > 0) {
+        printf(",%llu,%llu,%llu\n",
+                (unsigned long long)bench_hist_percentile(hist, 0.5),
+                (unsigned long long)bench_hist_percentile(hist, 0.99),
+                (unsigned long long)bench_hist_percentile(hist, 0.999));
+    } else {
+        printf(",,,\n");
+    }
+
+    fflush(stdout);
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+static size_t bench_frames(size_t fsize) {
+
+    size_t n = volume / fsize;
+
+    /* enough frames for a meaningful measurement, but not forever */
+    if (n < 1000) {
+        n = 1000;
+    } else if (n > 10000000) {
+        n = 10000000;
+    }
+
+    return n;
+}
+
+
+/*
+ * Function to run one single-threaded configuration for ringbuffer_t
+ * ___________________________________________________________________________
+ */
+static void bench_single(const char* api, size_t fsize, size_t bsize,
+        int pattern, uint8_t* mem, uint8_t* data, uint8_t* out) {
+
+    ringbuffer_t rb;
+    ringbuffer_span_t frames[BENCH_BATCH];
+    uint8_t header[4] = { 0 };
+    size_t n = bench_frames(fsize);
+    size_t done = 0;
+    size_t refused = 0;
+    size_t i;
+    size_t j;
+
+    ringbuffer_init(&rb, mem, bsize);
+
+    /* the plain functions get an odd, the frame functions a framed
+     * backlog (of frames the functions measured can read back) */
+    if (pattern != 0) {
+        if (strcmp(api, "bytes") == 0) {
+            ringbuffer_write(&rb, data, rb.size / 2 + 1);
+        } else if (strcmp(api, "header") == 0) {
+            while (ringbuffer_get_len(&rb) + fsize + 16 < rb.size / 2) {
+                ringbuffer_write_frame_with_header(&rb, header,
+                        sizeof(header), data, fsize);
+            }
+        } else {
+            while (ringbuffer_get_len(&rb) + fsize + 16 < rb.size / 2) {
+                ringbuffer_write_frame(&rb, data, fsize);
+            }
+        }
+    }
+
+    for (j = 0; j < BENCH_BATCH; ++j) {
+        frames[j].data = data;
+        frames[j].len = fsize;
+    }
+
+    uint64_t t0 = bench_now();
+
+    if (strcmp(api, "bytes") == 0) {
+        for (i = 0; i < n; ++i) {
+            if (ringbuffer_write(&rb, data, fsize) != fsize) {
+                ++refused;
+            }
+            if (ringbuffer_read(&rb, out, fsize) == fsize) {
+                ++done;
+            }
+        }
+    } else if (strcmp(api, "frame") == 0) {
+        for (i = 0; i < n; ++i) {
+            if (ringbuffer_write_frame(&rb, data, fsize) == 0) {
+                ++refused;
+            }
+            if (ringbuffer_read_frame(&rb, out, fsize) == fsize) {
+                ++done;
+            }
+        }
+    } else if (strcmp(api, "frames") == 0) {
+        ringbuffer_span_t read[BENCH_BATCH];
+        for (i = 0; i < n; i += BENCH_BATCH) {
+            refused += BENCH_BATCH
+                    - ringbuffer_write_frames(&rb, frames, BENCH_BATCH);
+            done += ringbuffer_read_frames(&rb, read, BENCH_BATCH, out,
+                    BENCH_BATCH * fsize);
+        }
+    } else {
+        for (i = 0; i < n; ++i) {
+            if (ringbuffer_write_frame_with_header(&rb, header,
+                    sizeof(header), data, fsize) == 0) {
+                ++refused;
+            }
+            if (ringbuffer_read_frame_with_header(&rb, header,
+                    sizeof(header), out, fsize) == fsize) {
+                ++done;
+            }
+        }
+    }
+
+    uint64_t t1 = bench_now();
+
+    bench_report("ringbuffer", api, fsize, rb.size, patterns[pattern], 1,
+            done, refused, t1 - t0, 0);
+}
+
+
+/* the state shared by producer and consumer */
+typedef struct {
+
+    /* the ring buffer used (a ringbuffer_t is guarded by lock) */
+    ringbuffer_t* rb;
+    pthread_mutex_t* lock;
+    ringbuffer_spsc_t* spsc;
+    ringbuffer_mpmc_t* mpmc;
+
+    /* message size and number of messages */
+    size_t fsize;
+    size_t n;
+
+    /* number of writes refused (producer) or messages received (consumer) */
+    size_t count;
+
+    /* the core to run on (or -1) */
+    int core;
+
+    bench_hist_t* hist;
+
+} bench_pc_t;
+
+
+/*
+ * ___________________________________________________________________________
+ */
+static void bench_pin(int core) {
+
+    if (core >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+static void* bench_producer(void* arg) {
+
+    bench_pc_t* pc = (bench_pc_t*)arg;
+    uint8_t* msg = (uint8_t*)calloc(1, pc->fsize);
+    size_t i;
+
+    bench_pin(pc->core);
+
+    for (i = 0; i < pc->n; ++i) {
+
+        /* stamp messages large enough to carry the time */
+        if (pc->fsize >= sizeof(uint64_t)) {
+            uint64_t t = bench_now();
+            memcpy(msg, &t, sizeof(t));
+        }
+
+        if (pc->rb != 0) {
+            for (;;) {
+                pthread_mutex_lock(pc->lock);
+                size_t k = ringbuffer_write_frame(pc->rb, msg, pc->fsize);
+                pthread_mutex_unlock(pc->lock);
+                if (k != 0) {
+                    break;
+                }
+                ++pc->count;
+                sched_yield();
+            }
+        } else if (pc->spsc != 0) {
+            size_t off = 0;
+            while (off < pc->fsize) {
+                size_t k = ringbuffer_spsc_write(pc->spsc, msg + off,
+                        pc->fsize - off);
+                if (k == 0) {
+                    ++pc->count;
+                    sched_yield();
+                }
+                off += k;
+            }
+        } else {
+            while (ringbuffer_mpmc_write_frame(pc->mpmc, msg,
+                    pc->fsize) == 0) {
+                ++pc->count;
+                sched_yield();
+            }
+        }
+    }
+
+    free(msg);
+
+    return 0;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+static void* bench_consumer(void* arg) {
+
+    bench_pc_t* pc = (bench_pc_t*)arg;
+    uint8_t* msg = (uint8_t*)malloc(pc->fsize);
+    size_t i;
+
+    bench_pin(pc->core);
+
+    for (i = 0; i < pc->n; ++i) {
+
+        if (pc->rb != 0) {
+            for (;;) {
+                pthread_mutex_lock(pc->lock);
+                size_t k = ringbuffer_read_frame(pc->rb, msg, pc->fsize);
+                pthread_mutex_unlock(pc->lock);
+                if (k == pc->fsize) {
+                    break;
+                }
+                sched_yield();
+            }
+        } else if (pc->spsc != 0) {
+            size_t off = 0;
+            while (off < pc->fsize) {
+                size_t k = ringbuffer_spsc_read(pc->spsc, msg + off,
+                        pc->fsize - off);
+                if (k == 0) {
+                    sched_yield();
+                }
+                off += k;
+            }
+        } else {
+            while (ringbuffer_mpmc_read_frame(pc->mpmc, msg,
+                    pc->fsize) != pc->fsize) {
+                sched_yield();
+            }
+        }
+        ++pc->count;
+
+        if (pc->fsize >= sizeof(uint64_t)) {
+            uint64_t t;
+            memcpy(&t, msg, sizeof(t));
+            ++pc->hist->counts[bench_hist_index(bench_now() - t)];
+            ++pc->hist->total;
+        }
+    }
+
+    free(msg);
+
+    return 0;
+}
+
+
+/*
+ * Function to run one producer/consumer configuration
+ * ___________________________________________________________________________
+ */
+static void bench_threads(const char* ring, size_t fsize, size_t bsize,
+        uint8_t* mem, int ncores) {
+
+    ringbuffer_t rb;
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    ringbuffer_spsc_t spsc;
+    ringbuffer_mpmc_t mpmc;
+    bench_pc_t producer;
+    bench_pc_t consumer;
+    pthread_t threads[2];
+    bench_hist_t* hist = (bench_hist_t*)calloc(1, sizeof(bench_hist_t));
+    size_t size;
+
+    memset(&producer, 0, sizeof(producer));
+    if (strcmp(ring, "ringbuffer") == 0) {
+        ringbuffer_init(&rb, mem, bsize);
+        producer.rb = &rb;
+        producer.lock = &lock;
+        size = rb.size;
+    } else if (strcmp(ring, "spsc") == 0) {
+        ringbuffer_spsc_init(&spsc, mem, bsize);
+        producer.spsc = &spsc;
+        size = spsc.size;
+    } else {
+        /* the bookkeeping of the cells takes its share of the memory */
+        size = ringbuffer_mpmc_init(&mpmc, mem, bsize, BENCH_CELL_SIZE)
+                * BENCH_CELL_SIZE;
+        producer.mpmc = &mpmc;
+        if (fsize > size) {
+            free(hist);
+            return;
+        }
+    }
+    producer.fsize = fsize;
+    producer.n = bench_frames(fsize);
+    producer.hist = hist;
+    consumer = producer;
+
+    /* one core each (if there are two) */
+    producer.core = (ncores >= 2) ? 0 : -1;
+    consumer.core = (ncores >= 2) ? 1 : -1;
+
+    uint64_t t0 = bench_now();
+    pthread_create(&threads[0], 0, bench_consumer, &consumer);
+    pthread_create(&threads[1], 0, bench_producer, &producer);
+    pthread_join(threads[1], 0);
+    pthread_join(threads[0], 0);
+    uint64_t t1 = bench_now();
+
+    bench_report(ring, (producer.rb != 0) ? "frame" : "stream", fsize, size,
+            "concurrent", 2, consumer.count, producer.count, t1 - t0, hist);
+
+    free(hist);
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+int main(int argc, char* argv[]) {
+
+    static const char* apis[] = { "bytes", "frame", "frames", "header" };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "qv:")) != -1) {
+        if (opt == 'q') {
+            volume /= 16;
+        } else if (opt == 'v') {
+            volume = (size_t)strtoul(optarg, 0, 10) << 20;
+        } else {
+            fprintf(stderr, "usage: %s [-q] [-v MB]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    size_t bsizeMax = bufferSizes[sizeof(bufferSizes)
+            / sizeof(bufferSizes[0]) - 1];
+    size_t fsizeMax = frameSizes[sizeof(frameSizes)
+            / sizeof(frameSizes[0]) - 1];
+
+    /* aligned for the MPMC cells */
+    uint8_t* mem = (uint8_t*)aligned_alloc(RINGBUFFER_CACHE_LINE, bsizeMax);
+    uint8_t* data = (uint8_t*)malloc(BENCH_BATCH * fsizeMax);
+    uint8_t* out = (uint8_t*)malloc(BENCH_BATCH * fsizeMax);
+    if (mem == 0 || data == 0 || out == 0) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    memset(mem, 0, bsizeMax);
+    memset(data, 0xA5, BENCH_BATCH * fsizeMax);
+
+    int ncores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    /* describe the configuration measured */
+    printf("# ringbuffer_bench: volume %zu bytes per run, %d cores\n",
+            volume, ncores);
+#ifdef RINGBUFFER_POW2
+    printf("# RINGBUFFER_POW2\n");
+#endif
+#ifdef RINGBUFFER_MIRROR
+    printf("# RINGBUFFER_MIRROR\n");
+#endif
+#ifdef RINGBUFFER_OVERWRITE
+    printf("# RINGBUFFER_OVERWRITE\n");
+#endif
+    printf("# RINGBUFFER_FRAME_PREFIX %d\n", (int)RINGBUFFER_FRAME_PREFIX);
+    printf("ring,api,frame_size,buffer_size,pattern,threads,frames,refused,"
+            "bytes_per_s,frames_per_s,p50_ns,p99_ns,p999_ns\n");
+
+    size_t f;
+    size_t b;
+    size_t a;
+    int p;
+
+    for (b = 0; b < sizeof(bufferSizes) / sizeof(bufferSizes[0]); ++b) {
+        for (f = 0; f < sizeof(frameSizes) / sizeof(frameSizes[0]); ++f) {
+
+            size_t fsize = frameSizes[f];
+            size_t bsize = bufferSizes[b];
+
+            /* frames have to fit in next to a backlog of half the buffer
+             * (in batches for the batched functions) */
+            for (a = 0; a < sizeof(apis) / sizeof(apis[0]); ++a) {
+                size_t need = (strcmp(apis[a], "frames") == 0)
+                        ? BENCH_BATCH * (fsize + 16) : fsize + 16;
+                if (need > bsize / 2) {
+                    continue;
+                }
+                for (p = 0; p < 2; ++p) {
+                    bench_single(apis[a], fsize, bsize, p, mem, data, out);
+                }
+            }
+
+            if (fsize <= bsize / 2) {
+                bench_threads("ringbuffer", fsize, bsize, mem, ncores);
+                bench_threads("spsc", fsize, bsize, mem, ncores);
+                bench_threads("mpmc", fsize, bsize, mem, ncores);
+            }
+        }
+    }
+
+    free(mem);
+    free(data);
+    free(out);
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development 
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+/* for memfd_create() */
+#define _GNU_SOURCE
+
+#include "ringbuffer_mirror.h"
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifndef RINGBUFFER_MIRROR
+    #error "ringbuffer_mirror.c requires RINGBUFFER_MIRROR"
+#endif
+
+
+/*
+ * ___________________________________________________________________________
+ */
+uint8_t* ringbuffer_mirror_alloc(size_t* size) {
+
+    uint8_t* mem = 0;
+
+    if (size != 0 && *size > 0) {
+
+        /* round up to whole pages ... */
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size_t len = ((*size + page - 1) / page) * page;
+
+#ifdef RINGBUFFER_POW2
+        /* ... and to a power of two (page sizes are powers of two) */
+        size_t pow2 = page;
+        while (pow2 < len) {
+            pow2 *= 2;
+        }
+        len = pow2;
+#endif
+
+        int fd = memfd_create("ringbuffer", MFD_CLOEXEC);
+        if (fd < 0) {
+            return 0;
+        }
+
+        if (ftruncate(fd, (off_t)len) == 0) {
+
+            /* reserve address space for both mappings ... */
+            void* base = mmap(0, 2 * len, PROT_NONE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+            if (base != MAP_FAILED) {
+
+                /* ... and map the memory twice into it */
+                if (mmap(base, len, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED
+                        && mmap((uint8_t*)base + len, len,
+                                PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED) {
+                    mem = (uint8_t*)base;
+                    *size = len;
+                } else {
+                    munmap(base, 2 * len);
+                }
+            }
+        }
+
+        /* the mappings keep the memory alive */
+        close(fd);
+    }
+
+    return mem;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+void ringbuffer_mirror_free(uint8_t* mem, size_t size) {
+
+    if (mem != 0) {
+        munmap(mem, 2 * size);
+    }
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+int ringbuffer_init_mirrored(ringbuffer_t* rb, size_t size) {
+
+    int ret = -1;
+
+    if (rb != 0) {
+
+        uint8_t* mem = ringbuffer_mirror_alloc(&size);
+
+        if (mem != 0) {
+            ringbuffer_init(rb, mem, size);
+            rb->mirrored = 1;
+            ret = 0;
+        }
+    }
+
+    return ret;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+void ringbuffer_free_mirrored(ringbuffer_t* rb) {
+
+    if (rb != 0 && rb->mirrored != 0) {
+        ringbuffer_mirror_free(rb->buffer, rb->size);
+        rb->buffer = 0;
+        rb->size = 0;
+        rb->mirrored = 0;
+        ringbuffer_clear(rb);
+    }
+}
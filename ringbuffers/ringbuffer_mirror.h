@@ -0,0 +1,58 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development 
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef RINGBUFFER_MIRROR_H_
+#define RINGBUFFER_MIRROR_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ringbuffer.h"
+
+/*
+ * Linux-only allocator for mirrored ring buffers: the same (memfd backed)
+ * memory is mapped twice, back to back, such that any region of up to size
+ * bytes starting within the buffer is contiguous in virtual memory. Frames
+ * can then be accessed in place (ringbuffer_sniff_memory(),
+ * ringbuffer_sniff_frame_memory()) even if they straddle the end of the
+ * buffer. Requires ringbuffer.c to be compiled with RINGBUFFER_MIRROR.
+ */
+
+/* Function to allocate mirrored memory of at least *size bytes (rounded up
+ * to whole pages, and to a power of two with RINGBUFFER_POW2). Returns the
+ * memory (or 0 on failure) and sets *size to its actual size */
+uint8_t* ringbuffer_mirror_alloc(size_t* size);
+
+/* Function to release memory allocated by ringbuffer_mirror_alloc() */
+void ringbuffer_mirror_free(uint8_t* mem, size_t size);
+
+/* Function to initialize a ring buffer of at least size bytes using
+ * mirrored memory. Returns 0 on success */
+int ringbuffer_init_mirrored(ringbuffer_t* rb, size_t size);
+
+/* Function to release the memory of a ring buffer initialized by
+ * ringbuffer_init_mirrored() */
+void ringbuffer_free_mirrored(ringbuffer_t* rb);
+
+#endif
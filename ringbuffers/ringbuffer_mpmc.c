@@ -0,0 +1,253 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development 
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "ringbuffer_mpmc.h"
+#include <string.h>
+
+
+/*
+ * Function to return the number of cells occupied by a frame of length len
+ * ___________________________________________________________________________
+ */
+static inline size_t ringbuffer_mpmc_cells(ringbuffer_mpmc_t* q, size_t len) {
+
+    /* empty frames still need a cell to carry their length */
+    return (len == 0) ? 1 : (len + q->cellsize - 1) / q->cellsize;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_mpmc_init(ringbuffer_mpmc_t* q, uint8_t* mem, size_t memlen,
+        size_t cellsize) {
+
+    size_t ncells = 0;
+
+    if (q != 0 && mem != 0 && cellsize > 0) {
+
+        /* the memory needed per cell (bookkeeping and payload) */
+        size_t lenCell = sizeof(ringbuffer_mpmc_cell_t) + cellsize;
+
+        /* round down to a power of two */
+        if (memlen >= lenCell) {
+            ncells = 1;
+            while (ncells <= memlen / lenCell / 2) {
+                ncells *= 2;
+            }
+        }
+
+        q->cells = (ringbuffer_mpmc_cell_t*)mem;
+        q->buffer = mem + ncells * sizeof(ringbuffer_mpmc_cell_t);
+        q->ncells = ncells;
+        q->cellsize = cellsize;
+        atomic_init(&q->iw, 0);
+        atomic_init(&q->ir, 0);
+
+        size_t i;
+        for (i = 0; i < ncells; ++i) {
+            atomic_init(&q->cells[i].seq, i);
+            atomic_init(&q->cells[i].len, 0);
+        }
+    }
+
+    return ncells;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_mpmc_write_frame(ringbuffer_mpmc_t* q, const uint8_t* frame,
+        size_t len) {
+
+    /* the number of bytes from frame written to the queue */
+    size_t lenWritten = 0;
+
+    if (q != 0 && (frame != 0 || len == 0) && q->ncells > 0
+            && ringbuffer_mpmc_cells(q, len) <= q->ncells) {
+
+        size_t mask = q->ncells - 1;
+        size_t n = ringbuffer_mpmc_cells(q, len);
+        size_t i;
+
+        /* whether the cells of the frame have been claimed and whether to
+         * stop trying (claimed or queue full) */
+        int claimed = 0;
+        int done = 0;
+
+        size_t pos = atomic_load_explicit(&q->iw, memory_order_relaxed);
+        while (done == 0) {
+
+            /* all cells of the frame have to be free in this round ... */
+            intptr_t diff = 0;
+            for (i = 0; i < n && diff == 0; ++i) {
+                size_t seq = atomic_load_explicit(
+                        &q->cells[(pos + i) & mask].seq, memory_order_acquire);
+                diff = (intptr_t)(seq - (pos + i));
+            }
+
+            if (diff < 0) {
+                /* queue full (a cell still holds a frame of the last round) */
+                done = 1;
+            } else if (diff > 0) {
+                /* another producer has been faster */
+                pos = atomic_load_explicit(&q->iw, memory_order_relaxed);
+            } else if (atomic_compare_exchange_weak_explicit(&q->iw, &pos,
+                    pos + n, memory_order_relaxed, memory_order_relaxed)) {
+                /* ... before they can be claimed at once */
+                claimed = 1;
+                done = 1;
+            }
+        }
+
+        if (claimed != 0) {
+
+            /* copy the frame (splitting it at the end of the buffer) ... */
+            size_t offset = (pos & mask) * q->cellsize;
+            size_t tmpLen = q->ncells * q->cellsize - offset;
+            if (len <= tmpLen) {
+                memcpy(q->buffer + offset, frame, len);
+            } else {
+                memcpy(q->buffer + offset, frame, tmpLen);
+                memcpy(q->buffer, frame + tmpLen, len - tmpLen);
+            }
+            atomic_store_explicit(&q->cells[pos & mask].len, len,
+                    memory_order_relaxed);
+            lenWritten = len;
+
+            /* ... and publish it (release: contents before sequence numbers,
+             * the first cell being the one consumers look at last) */
+            for (i = n; i > 0; --i) {
+                atomic_store_explicit(&q->cells[(pos + i - 1) & mask].seq,
+                        pos + i, memory_order_release);
+            }
+        }
+    }
+
+    return lenWritten;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_mpmc_read_frame(ringbuffer_mpmc_t* q, uint8_t* frame,
+        size_t len) {
+
+    /* the number of bytes from frame read from the queue */
+    size_t lenRead = 0;
+
+    if (q != 0 && (frame != 0 || len == 0) && q->ncells > 0) {
+
+        size_t mask = q->ncells - 1;
+        size_t lenFrame = 0;
+        size_t n = 0;
+        size_t i;
+
+        /* whether the cells of the next frame have been claimed and whether
+         * to stop trying (claimed, queue empty or frame too long) */
+        int claimed = 0;
+        int done = 0;
+
+        size_t pos = atomic_load_explicit(&q->ir, memory_order_relaxed);
+        while (done == 0) {
+
+            /* the first cell of the next frame has to be published ... */
+            ringbuffer_mpmc_cell_t* cell = &q->cells[pos & mask];
+            size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+            intptr_t diff = (intptr_t)(seq - (pos + 1));
+
+            if (diff < 0) {
+                /* queue empty */
+                done = 1;
+            } else if (diff > 0) {
+                /* another consumer has been faster */
+                pos = atomic_load_explicit(&q->ir, memory_order_relaxed);
+            } else {
+                lenFrame = atomic_load_explicit(&cell->len,
+                        memory_order_relaxed);
+                if (lenFrame > len) {
+                    /* leave the frame in the queue (unless it is gone
+                     * already) */
+                    size_t ir = atomic_load_explicit(&q->ir,
+                            memory_order_relaxed);
+                    if (ir == pos) {
+                        done = 1;
+                    }
+                    pos = ir;
+                } else {
+                    /* ... before it can be claimed at once */
+                    n = ringbuffer_mpmc_cells(q, lenFrame);
+                    if (atomic_compare_exchange_weak_explicit(&q->ir, &pos,
+                            pos + n, memory_order_relaxed,
+                            memory_order_relaxed)) {
+                        claimed = 1;
+                        done = 1;
+                    }
+                }
+            }
+        }
+
+        if (claimed != 0) {
+
+            /* copy the frame (splitting it at the end of the buffer) ... */
+            size_t offset = (pos & mask) * q->cellsize;
+            size_t tmpLen = q->ncells * q->cellsize - offset;
+            if (lenFrame <= tmpLen) {
+                memcpy(frame, q->buffer + offset, lenFrame);
+            } else {
+                memcpy(frame, q->buffer + offset, tmpLen);
+                memcpy(frame + tmpLen, q->buffer, lenFrame - tmpLen);
+            }
+            lenRead = lenFrame;
+
+            /* ... and hand its cells to the next round (release: reads
+             * before sequence numbers) */
+            for (i = 0; i < n; ++i) {
+                atomic_store_explicit(&q->cells[(pos + i) & mask].seq,
+                        pos + i + q->ncells, memory_order_release);
+            }
+        }
+    }
+
+    return lenRead;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_mpmc_get_cells(ringbuffer_mpmc_t* q) {
+
+    size_t n = 0;
+
+    if (q != 0) {
+        size_t ir = atomic_load_explicit(&q->ir, memory_order_acquire);
+        n = atomic_load_explicit(&q->iw, memory_order_acquire) - ir;
+    }
+
+    return n;
+}
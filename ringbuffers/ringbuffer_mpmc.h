@@ -0,0 +1,110 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development 
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef RINGBUFFER_MPMC_H_
+#define RINGBUFFER_MPMC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+/*
+ * Lock-free multi-producer/multi-consumer frame queue with the framing
+ * semantics of ringbuffer_write_frame() and ringbuffer_read_frame(): any
+ * number of threads may write and read whole frames concurrently. The
+ * memory is divided into a power of two number of cells of a fixed size,
+ * each carrying a sequence number (Vyukov's bounded queue). A frame
+ * occupies as many consecutive cells as its length requires and is claimed
+ * by a single compare-and-swap of the writing (or reading) index, then
+ * copied without holding any lock and published (or released) through the
+ * sequence numbers of its cells. Frames are therefore never torn and leave
+ * the queue in the order they were claimed. The indices are kept on cache
+ * lines of their own (RINGBUFFER_CACHE_LINE bytes, see ringbuffer_spsc.h).
+ */
+
+#ifndef RINGBUFFER_CACHE_LINE
+    #define RINGBUFFER_CACHE_LINE 64
+#endif
+
+
+/* the bookkeeping of a cell */
+typedef struct {
+
+    /* sequence number: the cell's index while free, the index plus one
+     * while holding (part of) a frame */
+    atomic_size_t seq;
+
+    /* length of the frame starting at this cell */
+    atomic_size_t len;
+
+} ringbuffer_mpmc_cell_t;
+
+
+typedef struct {
+
+    /* writing index (free-running, in cells) */
+    _Alignas(RINGBUFFER_CACHE_LINE) atomic_size_t iw;
+
+    /* reading index (free-running, in cells) */
+    _Alignas(RINGBUFFER_CACHE_LINE) atomic_size_t ir;
+
+    /* pointer to the bookkeeping of the cells */
+    _Alignas(RINGBUFFER_CACHE_LINE) ringbuffer_mpmc_cell_t* cells;
+
+    /* pointer to the payload of the cells (ncells * cellsize bytes) */
+    uint8_t* buffer;
+
+    /* number of cells (a power of two) */
+    size_t ncells;
+
+    /* size of the payload of a cell */
+    size_t cellsize;
+
+} ringbuffer_mpmc_t;
+
+
+/* Function to initialize the queue with the largest power of two number of
+ * cells of cellsize bytes payload each that fits into memlen bytes of mem
+ * (which has to be aligned for ringbuffer_mpmc_cell_t). Not thread-safe.
+ * Returns the number of cells (0 if mem is too small) */
+size_t ringbuffer_mpmc_init(ringbuffer_mpmc_t* q, uint8_t* mem, size_t memlen,
+        size_t cellsize);
+
+/* Function to write a frame of len bytes (any thread). Returns len if the
+ * frame has been written and 0 if it does not fit in (queue full or frame
+ * longer than the queue's payload) */
+size_t ringbuffer_mpmc_write_frame(ringbuffer_mpmc_t* q, const uint8_t* frame,
+        size_t len);
+
+/* Function to read the next frame into up to len bytes of frame (any
+ * thread). Returns the length of the frame, or 0 if there is no frame or it
+ * does not fit into len bytes (in which case it remains in the queue) */
+size_t ringbuffer_mpmc_read_frame(ringbuffer_mpmc_t* q, uint8_t* frame,
+        size_t len);
+
+/* Function to return the number of cells in use (a snapshot only) */
+size_t ringbuffer_mpmc_get_cells(ringbuffer_mpmc_t* q);
+
+#endif
@@ -0,0 +1,266 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development 
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef RINGBUFFER_RING_H_
+#define RINGBUFFER_RING_H_
+
+#ifndef __cplusplus
+    #error "ringbuffer_ring.h requires C++"
+#endif
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include "ringbuffer.h"
+
+/*
+ * Header-only C++ ring buffer of N fixed-size records of type T (e.g.
+ * microtag_t or timestamp_t). Records are stored back to back without
+ * length prefixes and moved in bulk, and as the capacity in bytes is a
+ * compile-time constant, the compiler can fold the index arithmetic. The
+ * state is kept in a plain ringbuffer_t (with the compile-time options of
+ * ringbuffer.c), so C code may produce records with ringbuffer_write() of
+ * sizeof(T) bytes each (or multiples thereof) while C++ code consumes them
+ * (or the other way round):
+ *
+ *  - ringbuffer::ring<T, N> owns its memory; its ringbuffer_t is available
+ *    through c_ring() to be handed to C code
+ *  - ringbuffer::ring_view<T, N> operates on a ringbuffer_t initialized by
+ *    C code with N * sizeof(T) bytes of memory
+ *
+ * With RINGBUFFER_POW2, N * sizeof(T) has to be a power of two. With
+ * RINGBUFFER_STATS, the byte counters of the ringbuffer_t are maintained
+ * (records are not counted as frames). Like ringbuffer_t itself, neither is
+ * thread-safe.
+ */
+
+namespace ringbuffer {
+
+template <typename T, std::size_t N>
+class ring_view {
+
+    static_assert(std::is_trivially_copyable<T>::value,
+            "records have to be trivially copyable");
+    static_assert(N > 0, "capacity must not be zero");
+
+public:
+
+    /* capacity in bytes */
+    static constexpr std::size_t size_bytes = N * sizeof(T);
+
+#ifdef RINGBUFFER_POW2
+    static_assert((size_bytes & (size_bytes - 1)) == 0,
+            "N * sizeof(T) has to be a power of two with RINGBUFFER_POW2");
+#endif
+
+    explicit ring_view(ringbuffer_t* rb) : rb_(rb) {
+        assert(rb != 0 && rb->size == size_bytes);
+    }
+
+    /* capacity in records */
+    static constexpr std::size_t capacity() {
+        return N;
+    }
+
+    /* number of records */
+    std::size_t size() const {
+        return length() / sizeof(T);
+    }
+
+    bool empty() const {
+        return length() == 0;
+    }
+
+    bool full() const {
+        return length() + sizeof(T) > size_bytes;
+    }
+
+    void clear() {
+        ringbuffer_clear(rb_);
+    }
+
+    /* Function to append a record. Returns false if the ring is full */
+    bool push(const T& record) {
+        return push(&record, 1) == 1;
+    }
+
+    /* Function to remove the oldest record. Returns false if the ring is
+     * empty */
+    bool pop(T& record) {
+        return pop(&record, 1) == 1;
+    }
+
+    /* Function to return the oldest record (the ring must not be empty) */
+    T front() const {
+        T record;
+        copy_from(rb_->ir, &record, 1);
+        return record;
+    }
+
+    /* Function to append up to n records (as far as they fit in). Returns
+     * the number of records appended */
+    std::size_t push(const T* records, std::size_t n) {
+
+        std::size_t space = (size_bytes - length()) / sizeof(T);
+        if (n > space) {
+#ifdef RINGBUFFER_STATS
+            ++rb_->stats.rejectedWrites;
+            rb_->stats.rejectedBytes += (n - space) * sizeof(T);
+#endif
+            n = space;
+        }
+
+        copy_to(rb_->iw, records, n);
+#ifdef RINGBUFFER_POW2
+        rb_->iw += n * sizeof(T);
+#else
+        rb_->iw = wrap(rb_->iw + n * sizeof(T));
+        rb_->len += n * sizeof(T);
+#endif
+
+#ifdef RINGBUFFER_STATS
+        rb_->stats.bytesIn += n * sizeof(T);
+        if (length() > rb_->stats.peakLen) {
+            rb_->stats.peakLen = length();
+        }
+#endif
+
+        return n;
+    }
+
+    /* Function to remove up to n of the oldest records. Returns the number
+     * of records removed */
+    std::size_t pop(T* records, std::size_t n) {
+
+        std::size_t avail = length() / sizeof(T);
+        if (n > avail) {
+#ifdef RINGBUFFER_STATS
+            ++rb_->stats.shortReads;
+#endif
+            n = avail;
+        }
+
+        copy_from(rb_->ir, records, n);
+#ifdef RINGBUFFER_POW2
+        rb_->ir += n * sizeof(T);
+#else
+        rb_->ir = wrap(rb_->ir + n * sizeof(T));
+        rb_->len -= n * sizeof(T);
+#endif
+
+#ifdef RINGBUFFER_STATS
+        rb_->stats.bytesOut += n * sizeof(T);
+#endif
+
+        return n;
+    }
+
+    /* the underlying C ring buffer */
+    ringbuffer_t* c_ring() const {
+        return rb_;
+    }
+
+private:
+
+    std::size_t length() const {
+#ifdef RINGBUFFER_POW2
+        return rb_->iw - rb_->ir;
+#else
+        return rb_->len;
+#endif
+    }
+
+    /* Function to map an index to a position in the buffer (assuming it
+     * never exceeds twice the size) */
+    static std::size_t wrap(std::size_t index) {
+#ifdef RINGBUFFER_POW2
+        return index & (size_bytes - 1);
+#else
+        return (index >= size_bytes) ? index - size_bytes : index;
+#endif
+    }
+
+    /* the records fit between the end of the buffer and a position as
+     * long as the positions are multiples of sizeof(T), so a bulk copy is
+     * split into at most two parts on record boundaries */
+    void copy_to(std::size_t index, const T* records, std::size_t n) {
+        std::size_t pos = wrap(index);
+        std::size_t first = (size_bytes - pos) / sizeof(T);
+        if (first > n) {
+            first = n;
+        }
+        std::memcpy(rb_->buffer + pos, records, first * sizeof(T));
+        std::memcpy(rb_->buffer, records + first, (n - first) * sizeof(T));
+    }
+
+    void copy_from(std::size_t index, T* records, std::size_t n) const {
+        std::size_t pos = wrap(index);
+        std::size_t first = (size_bytes - pos) / sizeof(T);
+        if (first > n) {
+            first = n;
+        }
+        std::memcpy(records, rb_->buffer + pos, first * sizeof(T));
+        std::memcpy(records + first, rb_->buffer, (n - first) * sizeof(T));
+    }
+
+    ringbuffer_t* rb_;
+};
+
+
+namespace detail {
+
+/* the memory of a ring (a base class to be initialized before the view) */
+template <typename T, std::size_t N>
+struct ring_storage {
+
+    ring_storage() {
+        ringbuffer_init(&rb, mem, N * sizeof(T));
+    }
+
+    ringbuffer_t rb;
+
+    alignas(T) uint8_t mem[N * sizeof(T)];
+};
+
+}
+
+
+template <typename T, std::size_t N>
+class ring : private detail::ring_storage<T, N>, public ring_view<T, N> {
+
+public:
+
+    ring() : ring_view<T, N>(&this->rb) {
+    }
+
+    /* neither copyable nor movable (C code may hold the ringbuffer_t) */
+    ring(const ring&) = delete;
+    ring& operator=(const ring&) = delete;
+};
+
+}
+
+#endif
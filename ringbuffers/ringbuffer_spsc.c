@@ -0,0 +1,241 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development 
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "ringbuffer_spsc.h"
+#include <string.h>
+
+
+/*
+ * ___________________________________________________________________________
+ */
+static inline void ringbuffer_spsc_split(ringbuffer_spsc_t* rb, size_t index,
+        ringbuffer_span_t span[2], size_t len) {
+
+    /* the position in the buffer and the bytes up to its end */
+    size_t pos = index & (rb->size - 1);
+    size_t tmpLen = rb->size - pos;
+
+    span[0].data = rb->buffer + pos;
+    span[1].data = rb->buffer;
+
+    if (len > tmpLen) {
+        span[0].len = tmpLen;
+        span[1].len = len - tmpLen;
+    } else {
+        span[0].len = len;
+        span[1].len = 0;
+    }
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+void ringbuffer_spsc_init(ringbuffer_spsc_t* rb, uint8_t* mem, size_t memlen) {
+
+    if (rb != 0 && mem != 0 && memlen > 0) {
+
+        /* round down to a power of two */
+        size_t size = 1;
+        while (size <= memlen / 2) {
+            size *= 2;
+        }
+
+        rb->buffer = mem;
+        rb->size = size;
+        rb->irCached = 0;
+        rb->iwCached = 0;
+        atomic_init(&rb->iw, 0);
+        atomic_init(&rb->ir, 0);
+    }
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_spsc_get_len(ringbuffer_spsc_t* rb) {
+
+    size_t len = 0;
+
+    if (rb != 0) {
+        size_t ir = atomic_load_explicit(&rb->ir, memory_order_acquire);
+        len = atomic_load_explicit(&rb->iw, memory_order_acquire) - ir;
+    }
+
+    return len;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_spsc_get_space(ringbuffer_spsc_t* rb) {
+
+    size_t space = 0;
+
+    if (rb != 0) {
+        space = rb->size - ringbuffer_spsc_get_len(rb);
+    }
+
+    return space;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_spsc_reserve(ringbuffer_spsc_t* rb,
+        ringbuffer_span_t span[2], size_t len) {
+
+    /* the number of bytes actually reserved in ring buffer */
+    size_t lenReserved = 0;
+
+    if (rb != 0 && span != 0) {
+
+        size_t iw = atomic_load_explicit(&rb->iw, memory_order_relaxed);
+
+        /* only fetch the consumer's index if the cached one is too old */
+        size_t space = rb->size - (iw - rb->irCached);
+        if (len > space) {
+            rb->irCached = atomic_load_explicit(&rb->ir, memory_order_acquire);
+            space = rb->size - (iw - rb->irCached);
+            if (len > space) {
+                len = space;
+            }
+        }
+        lenReserved = len;
+
+        ringbuffer_spsc_split(rb, iw, span, len);
+    }
+
+    return lenReserved;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+void ringbuffer_spsc_commit(ringbuffer_spsc_t* rb, size_t len) {
+
+    if (rb != 0) {
+        /* publish the bytes written (release: contents before index) */
+        atomic_store_explicit(&rb->iw, atomic_load_explicit(
+                &rb->iw, memory_order_relaxed) + len, memory_order_release);
+    }
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_spsc_peek(ringbuffer_spsc_t* rb,
+        ringbuffer_span_t span[2], size_t len) {
+
+    /* the number of bytes actually accessible in ring buffer */
+    size_t lenPeeked = 0;
+
+    if (rb != 0 && span != 0) {
+
+        size_t ir = atomic_load_explicit(&rb->ir, memory_order_relaxed);
+
+        /* only fetch the producer's index if the cached one is too old */
+        size_t avail = rb->iwCached - ir;
+        if (len > avail) {
+            rb->iwCached = atomic_load_explicit(&rb->iw, memory_order_acquire);
+            avail = rb->iwCached - ir;
+            if (len > avail) {
+                len = avail;
+            }
+        }
+        lenPeeked = len;
+
+        ringbuffer_spsc_split(rb, ir, span, len);
+    }
+
+    return lenPeeked;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+void ringbuffer_spsc_consume(ringbuffer_spsc_t* rb, size_t len) {
+
+    if (rb != 0) {
+        /* hand the space back (release: reads before index) */
+        atomic_store_explicit(&rb->ir, atomic_load_explicit(
+                &rb->ir, memory_order_relaxed) + len, memory_order_release);
+    }
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_spsc_write(ringbuffer_spsc_t* rb, const uint8_t* data,
+        size_t len) {
+
+    /* the number of bytes actually written to ring buffer */
+    size_t lenWritten = 0;
+
+    if (data != 0) {
+
+        ringbuffer_span_t span[2];
+
+        lenWritten = ringbuffer_spsc_reserve(rb, span, len);
+        if (lenWritten > 0) {
+            memcpy(span[0].data, data, span[0].len);
+            memcpy(span[1].data, data + span[0].len, span[1].len);
+            ringbuffer_spsc_commit(rb, lenWritten);
+        }
+    }
+
+    return lenWritten;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_spsc_read(ringbuffer_spsc_t* rb, uint8_t* data, size_t len) {
+
+    /* the number of bytes actually read from ring buffer */
+    size_t lenRead = 0;
+
+    if (data != 0) {
+
+        ringbuffer_span_t span[2];
+
+        lenRead = ringbuffer_spsc_peek(rb, span, len);
+        if (lenRead > 0) {
+            memcpy(data, span[0].data, span[0].len);
+            memcpy(data + span[0].len, span[1].data, span[1].len);
+            ringbuffer_spsc_consume(rb, lenRead);
+        }
+    }
+
+    return lenRead;
+}
@@ -0,0 +1,111 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development 
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef RINGBUFFER_SPSC_H_
+#define RINGBUFFER_SPSC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "ringbuffer.h"
+
+/*
+ * Lock-free single-producer/single-consumer variant of ringbuffer_t: one
+ * context (e.g. an ISR or a thread) may write while another one (e.g. the
+ * main loop or a thread on another core) reads concurrently. Instead of a
+ * shared length, the producer and the consumer each own a free-running
+ * index (published with release and read with acquire semantics) on its
+ * own cache line of RINGBUFFER_CACHE_LINE bytes (default: 64, may be
+ * reduced on MCUs without cache). The size must be a power of two.
+ */
+
+#ifndef RINGBUFFER_CACHE_LINE
+    #define RINGBUFFER_CACHE_LINE 64
+#endif
+
+
+typedef struct {
+
+    /* writing index (free-running, only written by the producer) ... */
+    _Alignas(RINGBUFFER_CACHE_LINE) atomic_size_t iw;
+
+    /* ... and the producer's copy of the reading index */
+    size_t irCached;
+
+    /* reading index (free-running, only written by the consumer) ... */
+    _Alignas(RINGBUFFER_CACHE_LINE) atomic_size_t ir;
+
+    /* ... and the consumer's copy of the writing index */
+    size_t iwCached;
+
+    /* pointer to actual buffer */
+    _Alignas(RINGBUFFER_CACHE_LINE) uint8_t* buffer;
+
+    /* size of buffer (a power of two) */
+    size_t size;
+
+} ringbuffer_spsc_t;
+
+
+/* Function to initialize the ring buffer with the largest power of two not
+ * exceeding memlen bytes of mem (not thread-safe) */
+void ringbuffer_spsc_init(ringbuffer_spsc_t* rb, uint8_t* mem, size_t memlen);
+
+/* Function to return the length of the content (exact only if called by
+ * the producer or the consumer) */
+size_t ringbuffer_spsc_get_len(ringbuffer_spsc_t* rb);
+
+/* Function to return the free space (exact only if called by the producer
+ * or the consumer) */
+size_t ringbuffer_spsc_get_space(ringbuffer_spsc_t* rb);
+
+/* Function to write up to len bytes (producer only). Returns the number of
+ * bytes written */
+size_t ringbuffer_spsc_write(ringbuffer_spsc_t* rb, const uint8_t* data,
+        size_t len);
+
+/* Function to read up to len bytes (consumer only). Returns the number of
+ * bytes read */
+size_t ringbuffer_spsc_read(ringbuffer_spsc_t* rb, uint8_t* data, size_t len);
+
+/* Function to reserve up to len bytes of free space for writing in place
+ * (producer only, see ringbuffer_reserve()) */
+size_t ringbuffer_spsc_reserve(ringbuffer_spsc_t* rb,
+        ringbuffer_span_t span[2], size_t len);
+
+/* Function to publish len bytes written in place (producer only, len must
+ * not exceed the number of bytes reserved) */
+void ringbuffer_spsc_commit(ringbuffer_spsc_t* rb, size_t len);
+
+/* Function to access up to len bytes of content in place (consumer only,
+ * see ringbuffer_peek()) */
+size_t ringbuffer_spsc_peek(ringbuffer_spsc_t* rb,
+        ringbuffer_span_t span[2], size_t len);
+
+/* Function to release len bytes accessed in place (consumer only, len must
+ * not exceed the number of bytes peeked at) */
+void ringbuffer_spsc_consume(ringbuffer_spsc_t* rb, size_t len);
+
+#endif
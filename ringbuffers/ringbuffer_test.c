@@ -0,0 +1,463 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+/*
+ * Host test of the frame functions of ringbuffer_t, e.g.
+ *
+ *  gcc -o ringbuffer_test ringbuffer_test.c ringbuffer.c
+ *  gcc -DRINGBUFFER_OVERWRITE -DRINGBUFFER_POW2 -o ringbuffer_test \
+ *          ringbuffer_test.c ringbuffer.c
+ *
+ * (with the same RINGBUFFER_* options as ringbuffer.c, and
+ * ringbuffer_mirror.c with RINGBUFFER_MIRROR). Frames of random length
+ * carrying a sequence number are written and read through the single,
+ * batched and header variants and checked against a model of the frames
+ * expected in the ring buffer, with and (given RINGBUFFER_OVERWRITE)
+ * without overwriting. Failed checks are printed, and the exit status is
+ * non-zero if there were any.
+ */
+
+#include "ringbuffer.h"
+#ifdef RINGBUFFER_MIRROR
+#include "ringbuffer_mirror.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* frames per batch for ringbuffer_write_frames() / ringbuffer_read_frames() */
+#define TEST_BATCH          8
+
+/* the maximum frame length of the random tests (at least 1 byte, as empty
+ * frames cannot be told apart from refused ones by the return values) */
+#define TEST_FRAME_MAX      100
+
+/* the number of random operations per configuration */
+#define TEST_ROUNDS         20000
+
+/* the maximum number of frames in the model */
+#define TEST_MODEL_MAX      4096
+
+
+#define TEST_CHECK(cond) do { if (!(cond)) { \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        ++failures; } } while (0)
+
+
+/* a frame expected in the ring buffer */
+typedef struct {
+
+    /* sequence number (determining the frame's content) */
+    uint32_t seq;
+
+    /* length of the frame */
+    size_t len;
+
+} test_frame_t;
+
+
+/* the frames expected in the ring buffer (oldest first) */
+static test_frame_t model[TEST_MODEL_MAX];
+static size_t modelFirst = 0;
+static size_t modelCount = 0;
+
+/* the sequence number of the next frame written */
+static uint32_t seqNext = 0;
+
+/* the number of failed checks */
+static int failures = 0;
+
+
+/*
+ * Function to fill frame with the content of a frame with sequence number
+ * seq and length len
+ * ___________________________________________________________________________
+ */
+static void test_fill(uint8_t* frame, uint32_t seq, size_t len) {
+
+    size_t i;
+
+    for (i = 0; i < len; ++i) {
+        frame[i] = (uint8_t)((seq >> (8 * (i % 4))) + i / 4 * 31);
+    }
+}
+
+
+/*
+ * Function to check a frame read against the oldest frame of the model and
+ * to remove the latter
+ * ___________________________________________________________________________
+ */
+static void test_expect(const uint8_t* frame, size_t len) {
+
+    uint8_t expected[TEST_FRAME_MAX];
+
+    TEST_CHECK(modelCount > 0);
+    if (modelCount > 0) {
+        test_frame_t* f = &model[modelFirst];
+        test_fill(expected, f->seq, f->len);
+        TEST_CHECK(len == f->len);
+        TEST_CHECK(len == f->len && memcmp(frame, expected, len) == 0);
+        modelFirst = (modelFirst + 1) % TEST_MODEL_MAX;
+        --modelCount;
+    }
+}
+
+
+/*
+ * Function to append a frame to the model
+ * ___________________________________________________________________________
+ */
+static void test_append(uint32_t seq, size_t len) {
+
+    model[(modelFirst + modelCount) % TEST_MODEL_MAX].seq = seq;
+    model[(modelFirst + modelCount) % TEST_MODEL_MAX].len = len;
+    ++modelCount;
+}
+
+
+/*
+ * Function to remove the n oldest frames from the model (as evicted)
+ * ___________________________________________________________________________
+ */
+static void test_evict(size_t n) {
+
+    TEST_CHECK(n <= modelCount);
+    if (n > modelCount) {
+        n = modelCount;
+    }
+    modelFirst = (modelFirst + n) % TEST_MODEL_MAX;
+    modelCount -= n;
+}
+
+
+/*
+ * Function to return the number of frames evicted so far (0 without
+ * RINGBUFFER_OVERWRITE)
+ * ___________________________________________________________________________
+ */
+static size_t test_dropped(ringbuffer_t* rb) {
+
+#ifdef RINGBUFFER_OVERWRITE
+    return ringbuffer_get_dropped(rb, 0);
+#else
+    (void)rb;
+    return 0;
+#endif
+}
+
+
+/*
+ * Function to test the single frame functions on corner cases
+ * ___________________________________________________________________________
+ */
+static void test_basic(ringbuffer_t* rb) {
+
+    uint8_t frame[TEST_FRAME_MAX];
+    uint8_t out[TEST_FRAME_MAX];
+    size_t len = 0;
+
+    ringbuffer_clear(rb);
+    TEST_CHECK(ringbuffer_count_frames(rb) == 0);
+    TEST_CHECK(ringbuffer_read_frame(rb, out, sizeof(out)) == 0);
+    TEST_CHECK(ringbuffer_sniff_frame_memory(rb, &len) == 0);
+
+    /* a frame is read back as written ... */
+    test_fill(frame, 1, 10);
+    TEST_CHECK(ringbuffer_write_frame(rb, frame, 10) == 10);
+    TEST_CHECK(ringbuffer_count_frames(rb) == 1);
+    TEST_CHECK(ringbuffer_sniff_frame_length(rb) == 10);
+    TEST_CHECK(ringbuffer_sniff_frame(rb, out, sizeof(out)) == 10);
+    TEST_CHECK(memcmp(out, frame, 10) == 0);
+
+    /* ... but stays in the ring buffer if the buffer is too short ... */
+    TEST_CHECK(ringbuffer_read_frame(rb, out, 9) == 0);
+    TEST_CHECK(ringbuffer_count_frames(rb) == 1);
+    TEST_CHECK(ringbuffer_read_frame(rb, out, sizeof(out)) == 10);
+    TEST_CHECK(memcmp(out, frame, 10) == 0);
+    TEST_CHECK(ringbuffer_count_frames(rb) == 0);
+    TEST_CHECK(ringbuffer_get_len(rb) == 0);
+
+    /* ... and empty frames are frames as well */
+    TEST_CHECK(ringbuffer_write_frame(rb, frame, 0) == 0);
+    TEST_CHECK(ringbuffer_count_frames(rb) == 1);
+    TEST_CHECK(ringbuffer_discard_frame(rb) != 0);
+    TEST_CHECK(ringbuffer_count_frames(rb) == 0);
+
+    /* frames longer than the ring buffer are refused (without evicting
+     * anything, also in overwrite mode) */
+    TEST_CHECK(ringbuffer_write_frame(rb, frame, 10) == 10);
+    {
+        uint8_t* big = (uint8_t*)calloc(1, rb->size + 1);
+        TEST_CHECK(ringbuffer_write_frame(rb, big, rb->size) == 0);
+        TEST_CHECK(ringbuffer_write_frame(rb, big, rb->size + 1) == 0);
+        free(big);
+    }
+    TEST_CHECK(ringbuffer_count_frames(rb) == 1);
+    TEST_CHECK(ringbuffer_read_frame(rb, out, sizeof(out)) == 10);
+
+    /* a frame with a header is read back in two parts */
+    {
+        uint8_t header[4] = { 1, 2, 3, 4 };
+        uint8_t hout[4] = { 0 };
+        TEST_CHECK(ringbuffer_write_frame_with_header(rb, header,
+                sizeof(header), frame, 10) != 0);
+        TEST_CHECK(ringbuffer_read_frame_with_header(rb, hout, sizeof(hout),
+                out, sizeof(out)) == 10);
+        TEST_CHECK(memcmp(hout, header, sizeof(header)) == 0);
+        TEST_CHECK(memcmp(out, frame, 10) == 0);
+    }
+
+    ringbuffer_clear(rb);
+}
+
+
+/*
+ * Function to write and read frames in random order and check them against
+ * the model (with overwriting if overwrite != 0)
+ * ___________________________________________________________________________
+ */
+static void test_random(ringbuffer_t* rb, int overwrite, unsigned int seed) {
+
+    uint8_t frames[TEST_BATCH][TEST_FRAME_MAX];
+    uint8_t out[TEST_BATCH * TEST_FRAME_MAX];
+    ringbuffer_span_t spans[TEST_BATCH];
+    size_t round;
+    size_t i;
+
+    /* frames of up to a quarter of the size, which are never refused for
+     * being longer than the ring buffer */
+    size_t lenMax = (rb->size / 4 < TEST_FRAME_MAX)
+            ? rb->size / 4 : TEST_FRAME_MAX;
+
+    srand(seed);
+    ringbuffer_clear(rb);
+    modelFirst = 0;
+    modelCount = 0;
+
+#ifdef RINGBUFFER_OVERWRITE
+    ringbuffer_set_overwrite(rb, overwrite);
+#endif
+
+    for (round = 0; round < TEST_ROUNDS; ++round) {
+
+        int op = rand() % 8;
+
+        /* favour writing when overwriting, such that frames get evicted */
+        size_t dropped = test_dropped(rb);
+
+        if (op < 3 + 2 * overwrite) {
+
+            /* write a single frame */
+            size_t len = 1 + (size_t)rand() % lenMax;
+            size_t written;
+            test_fill(frames[0], seqNext, len);
+            written = ringbuffer_write_frame(rb, frames[0], len);
+            TEST_CHECK(written == len || written == 0);
+            test_evict(test_dropped(rb) - dropped);
+            if (written == len) {
+                test_append(seqNext, len);
+            }
+            ++seqNext;
+
+        } else if (op < 4 + 2 * overwrite) {
+
+            /* write a batch of frames */
+            size_t n = 1 + (size_t)rand() % TEST_BATCH;
+            size_t written;
+            for (i = 0; i < n; ++i) {
+                spans[i].len = 1 + (size_t)rand() % lenMax;
+                spans[i].data = frames[i];
+                test_fill(frames[i], seqNext + (uint32_t)i, spans[i].len);
+            }
+            written = ringbuffer_write_frames(rb, spans, n);
+            TEST_CHECK(written <= n);
+            if (overwrite != 0) {
+                /* the oldest frames and the leading frames of the batch
+                 * are dropped, the others written */
+                size_t dropNew = n - written;
+                test_evict(test_dropped(rb) - dropped - dropNew);
+                for (i = dropNew; i < n; ++i) {
+                    test_append(seqNext + (uint32_t)i, spans[i].len);
+                }
+            } else {
+                /* the leading frames are written, the others refused */
+                for (i = 0; i < written; ++i) {
+                    test_append(seqNext + (uint32_t)i, spans[i].len);
+                }
+            }
+            seqNext += (uint32_t)n;
+
+        } else if (op < 7) {
+
+            /* read a single frame */
+            size_t len = ringbuffer_read_frame(rb, out, TEST_FRAME_MAX);
+            if (len > 0) {
+                test_expect(out, len);
+            } else {
+                TEST_CHECK(modelCount == 0);
+            }
+
+        } else {
+
+            /* read a batch of frames */
+            ringbuffer_span_t read[TEST_BATCH];
+            size_t n = ringbuffer_read_frames(rb, read, TEST_BATCH,
+                    out, sizeof(out));
+            for (i = 0; i < n; ++i) {
+                test_expect(read[i].data, read[i].len);
+            }
+        }
+
+        TEST_CHECK(ringbuffer_count_frames(rb) == modelCount);
+    }
+
+    /* all frames left are the ones expected */
+    while (ringbuffer_count_frames(rb) > 0) {
+        size_t len = ringbuffer_read_frame(rb, out, TEST_FRAME_MAX);
+        test_expect(out, len);
+    }
+    TEST_CHECK(modelCount == 0);
+    TEST_CHECK(ringbuffer_get_len(rb) == 0);
+
+#ifdef RINGBUFFER_OVERWRITE
+    ringbuffer_set_overwrite(rb, 0);
+#endif
+}
+
+
+#ifdef RINGBUFFER_OVERWRITE
+
+/*
+ * Function to test overwriting on corner cases
+ * ___________________________________________________________________________
+ */
+static void test_overwrite(ringbuffer_t* rb) {
+
+    /* frames of a third of the size, two of which fit in (with prefixes) */
+    size_t len = rb->size / 3;
+    uint8_t* frames = (uint8_t*)malloc(TEST_BATCH * len);
+    uint8_t* out = (uint8_t*)malloc(rb->size);
+    ringbuffer_span_t spans[TEST_BATCH];
+    ringbuffer_span_t read[TEST_BATCH];
+    size_t bytes = 0;
+    size_t i;
+
+    ringbuffer_clear(rb);
+    ringbuffer_set_overwrite(rb, 1);
+
+    /* a batch not fitting in as a whole keeps its newest frames ... */
+    for (i = 0; i < TEST_BATCH; ++i) {
+        test_fill(&frames[i * len], (uint32_t)i, len);
+        spans[i].data = &frames[i * len];
+        spans[i].len = len;
+    }
+    TEST_CHECK(ringbuffer_write_frame(rb, frames, 1) == 1);
+    TEST_CHECK(ringbuffer_write_frames(rb, spans, TEST_BATCH) == 2);
+
+    /* ... evicting all older frames */
+    TEST_CHECK(ringbuffer_get_dropped(rb, &bytes) == TEST_BATCH - 1);
+    TEST_CHECK(bytes == 1 + (TEST_BATCH - 2) * len);
+    TEST_CHECK(ringbuffer_read_frames(rb, read, TEST_BATCH, out,
+            rb->size) == 2);
+    for (i = 0; i < 2; ++i) {
+        TEST_CHECK(read[i].len == len && memcmp(read[i].data,
+                &frames[(TEST_BATCH - 2 + i) * len], len) == 0);
+    }
+
+    /* a frame evicts the oldest frames ... */
+    ringbuffer_clear(rb);
+    for (i = 0; i < TEST_BATCH; ++i) {
+        TEST_CHECK(ringbuffer_write_frame(rb, &frames[i * len], len) == len);
+    }
+    TEST_CHECK(ringbuffer_get_dropped(rb, 0) == TEST_BATCH - 2);
+    TEST_CHECK(ringbuffer_read_frame(rb, out, rb->size) == len);
+    TEST_CHECK(memcmp(out, &frames[(TEST_BATCH - 2) * len], len) == 0);
+
+    /* ... but not other content, which makes it be refused */
+    ringbuffer_clear(rb);
+    ringbuffer_write(rb, out, rb->size - len / 2);
+    TEST_CHECK(ringbuffer_write_frame(rb, frames, len) == 0);
+    TEST_CHECK(ringbuffer_get_len(rb) == rb->size - len / 2);
+    TEST_CHECK(ringbuffer_get_dropped(rb, 0) == 0);
+
+    ringbuffer_clear(rb);
+    ringbuffer_set_overwrite(rb, 0);
+
+    free(frames);
+    free(out);
+}
+
+#endif
+
+
+/*
+ * Function to run all tests on a ring buffer
+ * ___________________________________________________________________________
+ */
+static void test_all(ringbuffer_t* rb, const char* name) {
+
+    int before = failures;
+
+    test_basic(rb);
+    test_random(rb, 0, 1);
+#ifdef RINGBUFFER_OVERWRITE
+    test_random(rb, 1, 2);
+    /* (frames of a third of the size need to fit any prefix width) */
+    if (rb->size <= 256) {
+        test_overwrite(rb);
+    }
+#endif
+
+    printf("%s (%zu bytes): %s\n", name, rb->size,
+            (failures == before) ? "ok" : "FAILED");
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+int main(void) {
+
+    static const size_t sizes[] = { 64, 256, 1000, 4096 };
+    static uint8_t mem[4096];
+    ringbuffer_t rb;
+    size_t s;
+
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        ringbuffer_init(&rb, mem, sizes[s]);
+        test_all(&rb, "ringbuffer");
+    }
+
+#ifdef RINGBUFFER_MIRROR
+    if (ringbuffer_init_mirrored(&rb, 4096) == 0) {
+        test_all(&rb, "mirrored ringbuffer");
+        ringbuffer_free_mirrored(&rb);
+    }
+#endif
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,254 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development 
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* for syscall() */
+#define _GNU_SOURCE
+
+#include "ringbuffer_wait.h"
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+
+
+/*
+ * Function to return the current time of the monotonic clock in
+ * milliseconds
+ * ___________________________________________________________________________
+ */
+static int64_t ringbuffer_waiter_now(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+int ringbuffer_waiter_init(ringbuffer_waiter_t* w, int flags) {
+
+    int ret = -1;
+
+    if (w != 0) {
+
+        atomic_init(&w->seq, 0);
+        atomic_init(&w->parked, 0);
+        atomic_init(&w->armed, 0);
+        w->efd = -1;
+        ret = 0;
+
+        if ((flags & RINGBUFFER_WAITER_EVENTFD) != 0) {
+            w->efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            if (w->efd < 0) {
+                ret = -1;
+            }
+        }
+    }
+
+    return ret;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+void ringbuffer_waiter_destroy(ringbuffer_waiter_t* w) {
+
+    if (w != 0 && w->efd >= 0) {
+        close(w->efd);
+        w->efd = -1;
+    }
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+void ringbuffer_waiter_notify(ringbuffer_waiter_t* w) {
+
+    if (w != 0) {
+
+        /* sequentially consistent: either the consumer sees the new
+         * sequence number or we see it parked (or the eventfd armed) */
+        atomic_fetch_add(&w->seq, 1);
+
+        if (atomic_load(&w->parked) != 0) {
+            syscall(SYS_futex, &w->seq, FUTEX_WAKE_PRIVATE, INT_MAX,
+                    0, 0, 0);
+        }
+
+        if (w->efd >= 0 && atomic_load(&w->armed) != 0
+                && atomic_exchange(&w->armed, 0) != 0) {
+            uint64_t one = 1;
+            ssize_t ret = write(w->efd, &one, sizeof(one));
+            (void)ret;
+        }
+    }
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_waiter_wait(ringbuffer_waiter_t* w,
+        size_t (*avail)(void*), void* arg, size_t n, int timeout_ms) {
+
+    /* the amount available */
+    size_t len = 0;
+
+    if (w != 0 && avail != 0) {
+
+        int64_t deadline = ringbuffer_waiter_now() + timeout_ms;
+
+        /* whether enough is available or the timeout has expired */
+        int done = 0;
+
+        while (done == 0) {
+
+            /* fetch the sequence number before checking ... */
+            unsigned int seq = atomic_load(&w->seq);
+
+            struct timespec ts;
+            struct timespec* pts = 0;
+
+            len = avail(arg);
+            if (len >= n) {
+                done = 1;
+            } else if (timeout_ms >= 0) {
+                int64_t remaining = deadline - ringbuffer_waiter_now();
+                if (remaining <= 0) {
+                    done = 1;
+                } else {
+                    ts.tv_sec = (time_t)(remaining / 1000);
+                    ts.tv_nsec = (long)(remaining % 1000) * 1000000;
+                    pts = &ts;
+                }
+            }
+
+            if (done == 0) {
+                /* ... such that the futex refuses to sleep if a notification
+                 * arrived in between */
+                atomic_fetch_add(&w->parked, 1);
+                syscall(SYS_futex, &w->seq, FUTEX_WAIT_PRIVATE, seq, pts, 0, 0);
+                atomic_fetch_sub(&w->parked, 1);
+            }
+        }
+    }
+
+    return len;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+int ringbuffer_waiter_get_fd(ringbuffer_waiter_t* w) {
+
+    return (w != 0) ? w->efd : -1;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+void ringbuffer_waiter_arm(ringbuffer_waiter_t* w) {
+
+    if (w != 0 && w->efd >= 0) {
+        atomic_store(&w->armed, 1);
+    }
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+void ringbuffer_waiter_ack(ringbuffer_waiter_t* w) {
+
+    if (w != 0 && w->efd >= 0) {
+        uint64_t count;
+        ssize_t ret = read(w->efd, &count, sizeof(count));
+        (void)ret;
+    }
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+static size_t ringbuffer_spsc_avail(void* arg) {
+
+    return ringbuffer_spsc_get_len((ringbuffer_spsc_t*)arg);
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_spsc_wait(ringbuffer_spsc_t* rb, ringbuffer_waiter_t* w,
+        size_t len, int timeout_ms) {
+
+    size_t avail = 0;
+
+    if (rb != 0) {
+        avail = ringbuffer_waiter_wait(w, ringbuffer_spsc_avail, rb,
+                len, timeout_ms);
+    }
+
+    return avail;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+static size_t ringbuffer_mpmc_avail(void* arg) {
+
+    return ringbuffer_mpmc_get_cells((ringbuffer_mpmc_t*)arg);
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+size_t ringbuffer_mpmc_wait(ringbuffer_mpmc_t* q, ringbuffer_waiter_t* w,
+        int timeout_ms) {
+
+    size_t avail = 0;
+
+    if (q != 0) {
+        /* cells are only counted once claimed, so this may return before
+         * the frame is published: ringbuffer_mpmc_read_frame() then
+         * returns 0 and the wait is simply repeated */
+        avail = ringbuffer_waiter_wait(w, ringbuffer_mpmc_avail, q,
+                1, timeout_ms);
+    }
+
+    return avail;
+}
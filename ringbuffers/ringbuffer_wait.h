@@ -0,0 +1,111 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development 
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef RINGBUFFER_WAIT_H_
+#define RINGBUFFER_WAIT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "ringbuffer_spsc.h"
+#include "ringbuffer_mpmc.h"
+
+/*
+ * Linux-only blocking wait for consumers of the concurrent ring buffers
+ * (ringbuffer_spsc_t, ringbuffer_mpmc_t) instead of polling them: consumers
+ * park on a futex until the producer calls ringbuffer_waiter_notify() after
+ * writing. The producer only enters the kernel if a consumer is actually
+ * parked (or an eventfd has been armed), so notifying is a single atomic
+ * increment and load in the common case.
+ *
+ * With RINGBUFFER_WAITER_EVENTFD, the waiter additionally owns an eventfd to
+ * be added to a poll/epoll set. To sleep in epoll_wait(), a consumer
+ *
+ *  1. drains the ring buffer,
+ *  2. calls ringbuffer_waiter_arm(),
+ *  3. checks the ring buffer once more (continuing with 1. if not empty),
+ *  4. waits for the eventfd to become readable and
+ *  5. calls ringbuffer_waiter_ack() before continuing with 1.
+ */
+
+#define RINGBUFFER_WAITER_EVENTFD   0x01
+
+
+typedef struct {
+
+    /* futex word, incremented by every notification */
+    atomic_uint seq;
+
+    /* number of consumers parked on seq */
+    atomic_uint parked;
+
+    /* non-zero while an eventfd consumer waits for a notification */
+    atomic_uint armed;
+
+    /* eventfd (or -1) */
+    int efd;
+
+} ringbuffer_waiter_t;
+
+
+/* Function to initialize the waiter with flags (RINGBUFFER_WAITER_*).
+ * Returns 0 on success and -1 if the eventfd cannot be created */
+int ringbuffer_waiter_init(ringbuffer_waiter_t* w, int flags);
+
+/* Function to release the waiter's resources (i.e. the eventfd) */
+void ringbuffer_waiter_destroy(ringbuffer_waiter_t* w);
+
+/* Function to be called by producers after writing: wakes up parked
+ * consumers and signals an armed eventfd */
+void ringbuffer_waiter_notify(ringbuffer_waiter_t* w);
+
+/* Function to wait until avail(arg) returns at least n, or timeout_ms
+ * milliseconds have passed (a negative timeout waits forever). Returns the
+ * last value returned by avail(arg), i.e. less than n on timeout */
+size_t ringbuffer_waiter_wait(ringbuffer_waiter_t* w,
+        size_t (*avail)(void*), void* arg, size_t n, int timeout_ms);
+
+/* Function to return the eventfd (or -1 without RINGBUFFER_WAITER_EVENTFD) */
+int ringbuffer_waiter_get_fd(ringbuffer_waiter_t* w);
+
+/* Function to request a signal on the eventfd with the next notification */
+void ringbuffer_waiter_arm(ringbuffer_waiter_t* w);
+
+/* Function to reset the eventfd after it became readable */
+void ringbuffer_waiter_ack(ringbuffer_waiter_t* w);
+
+
+/* Function to wait until the ring buffer holds at least len bytes (see
+ * ringbuffer_waiter_wait()). Returns the number of bytes available */
+size_t ringbuffer_spsc_wait(ringbuffer_spsc_t* rb, ringbuffer_waiter_t* w,
+        size_t len, int timeout_ms);
+
+/* Function to wait until the queue holds at least one frame (see
+ * ringbuffer_waiter_wait()). Returns the number of cells in use (0 on
+ * timeout) */
+size_t ringbuffer_mpmc_wait(ringbuffer_mpmc_t* q, ringbuffer_waiter_t* w,
+        int timeout_ms);
+
+#endif
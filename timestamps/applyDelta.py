@@ -11,6 +11,8 @@ tags = {}
 tags[0xFE] = "TS_CALIBRATION_BEGIN"
 tags[0xFF] = "TS_CALIBRATION_END"
 
+# 0xFB and 0xFC are reserved for epoch markers (see timestamp.h)
+
 # Library init
 tags[0x00] = "TS_LIB_INIT_BEGIN"
 tags[0x01] = "TS_LIB_INIT_END"
@@ -0,0 +1,598 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development 
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "timestamp.h"
+
+#ifndef TIMESTAMP_N_MAX
+#define TIMESTAMP_N_MAX 128
+#endif
+
+#ifndef TIMESTAMP_COBS_STAMPS
+#define TIMESTAMP_COBS_STAMPS 32
+#endif
+
+#if TIMESTAMP_FORMAT == TIMESTAMP_FORMAT_COBS && TIMESTAMP_COBS_STAMPS > 42
+    /* keeps every frame within a single COBS block */
+    #error "TIMESTAMP_COBS_STAMPS must not exceed 42"
+#endif
+
+#if TIMESTAMP_FORMAT == TIMESTAMP_FORMAT_COBS
+    /* the maximum size of an encoded frame (stamps, CRC, COBS code byte
+     * and delimiter) ... */
+    #define TIMESTAMP_UNIT_MAX  (TIMESTAMP_COBS_STAMPS * 6 + 4)
+#else
+    /* ... or of an encoded time stamp (digits, CR and LF) */
+    #define TIMESTAMP_UNIT_MAX  10
+#endif
+
+#ifdef TIMESTAMP_ASYNC
+
+    #include "../ringbuffers/ringbuffer.h"
+
+    /* one bank records while the other one is sent out */
+    #define TIMESTAMP_BANKS 2
+
+    #ifndef TIMESTAMP_TX_SIZE
+        #define TIMESTAMP_TX_SIZE 512
+    #endif
+
+    #if TIMESTAMP_TX_SIZE < TIMESTAMP_UNIT_MAX
+        #error "TIMESTAMP_TX_SIZE is too small for the TIMESTAMP_FORMAT"
+    #endif
+
+    #if defined(RINGBUFFER_POW2) \
+            && ((TIMESTAMP_TX_SIZE) & ((TIMESTAMP_TX_SIZE) - 1)) != 0
+        #error "TIMESTAMP_TX_SIZE must be a power of two with RINGBUFFER_POW2"
+    #endif
+
+#else
+
+    #define TIMESTAMP_BANKS 1
+
+#endif
+
+
+/* the counter to hold the current number of time stamps in the buffer */
+static uint_fast16_t timestamp_n = 0;
+
+/* the bank time stamps are currently recorded into */
+static uint_fast8_t timestamp_bank = 0;
+
+#if TIMESTAMP_FORMAT == TIMESTAMP_FORMAT_HEX
+
+/* the buffer to hold time stamps between being set and being sent out,
+ * packed as sent out (see timestamp_pack()) in 4 bytes each */
+static uint32_t timestamp_buf[TIMESTAMP_BANKS][TIMESTAMP_N_MAX];
+
+#define TIMESTAMP_STORE(b, i, ticks, tag) \
+		(timestamp_buf[b][i] = timestamp_pack(ticks, tag))
+
+#elif defined(TIMESTAMP_COMPACT)
+
+/* the buffers to hold time stamps between being set and being set out,
+ * split into ticks and tags to avoid padding (6 instead of 8 bytes each) */
+static uint32_t timestamp_buf_ticks[TIMESTAMP_BANKS][TIMESTAMP_N_MAX];
+static uint16_t timestamp_buf_tags[TIMESTAMP_BANKS][TIMESTAMP_N_MAX];
+
+#define TIMESTAMP_TICKS(b, i)   timestamp_buf_ticks[b][i]
+#define TIMESTAMP_TAG(b, i)     timestamp_buf_tags[b][i]
+
+#else
+
+/* the buffer to hold time stamps between being set and being set out */
+static timestamp_t timestamp_buf[TIMESTAMP_BANKS][TIMESTAMP_N_MAX];
+
+#define TIMESTAMP_TICKS(b, i)   timestamp_buf[b][i].ticks
+#define TIMESTAMP_TAG(b, i)     timestamp_buf[b][i].tag
+
+#endif
+
+#ifndef TIMESTAMP_STORE
+#define TIMESTAMP_STORE(b, i, ticks, tag) \
+		(TIMESTAMP_TICKS(b, i) = (ticks), TIMESTAMP_TAG(b, i) = (tag))
+#endif
+
+#ifdef TIMESTAMP_ASYNC
+
+/* the memory backing the transmit ring */
+static uint8_t timestamp_tx_mem[TIMESTAMP_TX_SIZE];
+
+/* the transmit ring holding encoded time stamps until being sent out */
+static ringbuffer_t timestamp_tx = {
+        .buffer = timestamp_tx_mem, .size = TIMESTAMP_TX_SIZE };
+
+/* the bank being sent out, its number of time stamps and the number of
+ * time stamps encoded so far (only accessed by the sending side, i.e.
+ * timestamp_tx_complete(), while a flush is in flight) */
+static uint_fast8_t timestamp_tx_bank;
+static uint_fast16_t timestamp_tx_n;
+static uint_fast16_t timestamp_tx_i;
+
+/* the number of bytes handed to timestamp_start_tx() */
+static volatile size_t timestamp_tx_len = 0;
+
+/* non-zero while a flush is in flight */
+static volatile uint_fast8_t timestamp_tx_active = 0;
+
+/* non-zero while timestamp_tx_run() is driving the transmission, such that
+ * a completion reported from within timestamp_start_tx() does not recurse */
+static volatile uint_fast8_t timestamp_tx_running = 0;
+
+/* the function to call once a flush has completed */
+static timestamp_flush_done_t timestamp_flush_done = 0;
+
+/* externally defined function to start sending out len bytes at data
+ * (e.g. by DMA or a TX-empty interrupt chain), which has to call
+ * timestamp_tx_complete() when done */
+extern void timestamp_start_tx(const uint8_t* data, size_t len);
+
+#else
+
+/* externally defined function to send out one byte */
+extern void timestamp_send_byte(uint8_t byte);
+
+#endif
+
+/* externally defined function to return current tick counter */
+extern uint32_t timestamp_get_ticks(void);
+
+
+#if TIMESTAMP_FORMAT == TIMESTAMP_FORMAT_HEX
+
+/*
+ * Function to pack a time stamp into 32 bits: an 8-bit tag and the lower 24
+ * bits of the ticks (or all 32 bits of the ticks without a tag)
+ * ___________________________________________________________________________
+ */
+static inline uint32_t timestamp_pack(uint32_t ticks, uint_fast16_t tag) {
+
+	if (tag != TIMESTAMP_TAG_NONE) {
+		/* mask out 8 most significant bits ... */
+		ticks &= 0x00FFFFFF;
+		/* ... and place tag there instead */
+		ticks |= ((uint32_t)(tag & 0xFF)) << 24;
+	}
+
+	return ticks;
+}
+
+#endif
+
+
+/* the upper 32 bits of the 64-bit ticks (i.e. the number of wrap-arounds of
+ * the tick counter) and the ticks seen by the last timestamp_set_epoch() */
+static uint32_t timestamp_epoch_high = 0;
+static uint32_t timestamp_epoch_last = 0;
+
+
+/*
+ * Function to set a time stamp, i.e. write a time stamp to the buffer
+ * ___________________________________________________________________________
+ */
+void timestamp_set(uint_fast16_t tag) {
+
+	/* store in memory (unless full) */
+	if (timestamp_n < TIMESTAMP_N_MAX) {
+		TIMESTAMP_STORE(timestamp_bank, timestamp_n, timestamp_get_ticks(), tag);
+		++timestamp_n;
+	}
+}
+
+
+/*
+ * Function to set an epoch marker
+ * ___________________________________________________________________________
+ */
+void timestamp_set_epoch(void) {
+
+	uint32_t	ticks = timestamp_get_ticks();
+	uint64_t	ticks64;
+
+	/* the tick counter wrapped around since the last call */
+	if (ticks < timestamp_epoch_last) {
+		++timestamp_epoch_high;
+	}
+	timestamp_epoch_last = ticks;
+
+	ticks64 = ((uint64_t)timestamp_epoch_high << 32) | ticks;
+
+	/* store both time stamps of the marker in memory (unless full) */
+	if (timestamp_n + 1 < TIMESTAMP_N_MAX) {
+		TIMESTAMP_STORE(timestamp_bank, timestamp_n,
+				(uint32_t)(ticks64 >> TIMESTAMP_TICKS_BITS), TIMESTAMP_TAG_EPOCH);
+		TIMESTAMP_STORE(timestamp_bank, timestamp_n + 1,
+				ticks, TIMESTAMP_TAG_EPOCH_TICKS);
+		timestamp_n += 2;
+	}
+}
+
+
+/*
+ * Function to set a time stamp without a tag
+ * ___________________________________________________________________________
+ */
+void timestamp_set_notag(void) {
+
+	timestamp_set(TIMESTAMP_TAG_NONE);
+}
+
+
+#if TIMESTAMP_FORMAT == TIMESTAMP_FORMAT_HEX
+
+/*
+ * Function to encode a (packed) time stamp as 8 hex digits. Returns the
+ * number of bytes written to out
+ * ___________________________________________________________________________
+ */
+static uint_fast16_t timestamp_encode_stamp(uint8_t* out, uint32_t stamp) {
+
+	uint_fast8_t	j;
+
+    /* array used to convert data to hex */
+	static const uint8_t timestamp_hex[16] = {
+			'0', '1', '2', '3',	'4', '5', '6', '7',
+			'8', '9', 'A', 'B',	'C', 'D', 'E', 'F' };
+
+    /* process it (nibble by nibble) */
+	for (j = 0; j < 8; j++) {
+		out[j] = timestamp_hex[(stamp & 0xF0000000) >> 28];
+		stamp = stamp << 4;
+	}
+
+    /* newline */
+	out[8] = '\r';
+	out[9] = '\n';
+
+	return 10;
+}
+
+#elif TIMESTAMP_FORMAT == TIMESTAMP_FORMAT_BASE64
+
+/*
+ * Function to encode a time stamp as 8 base64 digits. Returns the number
+ * of bytes written to out
+ * ___________________________________________________________________________
+ */
+static uint_fast16_t timestamp_encode_stamp(
+		uint8_t* out, uint32_t ticks, uint16_t tag) {
+
+	uint_fast32_t	w1 = ticks;
+	uint_fast32_t	w2 = tag;
+
+    /* array used to convert data to base64 */
+	static const uint8_t timestamp_base64[64] = {
+			'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
+			'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+			'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X',
+			'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
+			'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n',
+			'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
+			'w', 'x', 'y', 'z', '0', '1', '2', '3',
+			'4', '5', '6', '7', '8', '9', '+', '/' };
+
+    /* 48 bits in groups of 6 */
+	out[0] = timestamp_base64[(w1 >> 26) & 0x3F];
+	out[1] = timestamp_base64[(w1 >> 20) & 0x3F];
+	out[2] = timestamp_base64[(w1 >> 14) & 0x3F];
+	out[3] = timestamp_base64[(w1 >> 8) & 0x3F];
+	out[4] = timestamp_base64[(w1 >> 2) & 0x3F];
+	out[5] = timestamp_base64[((w1 & 0x03) << 4) | ((w2 >> 12) & 0x0F)];
+	out[6] = timestamp_base64[(w2 >> 6) & 0x3F];
+	out[7] = timestamp_base64[w2 & 0x3F];
+
+    /* newline */
+	out[8] = '\r';
+	out[9] = '\n';
+
+	return 10;
+}
+
+#elif TIMESTAMP_FORMAT == TIMESTAMP_FORMAT_COBS
+
+/*
+ * Function to update a CRC-16/CCITT (polynomial 0x1021) by one byte
+ * ___________________________________________________________________________
+ */
+static uint16_t timestamp_crc16(uint16_t crc, uint8_t byte) {
+
+	uint_fast8_t	j;
+
+	crc ^= (uint16_t)byte << 8;
+	for (j = 8; j > 0; j--) {
+		crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021)
+				: (uint16_t)(crc << 1);
+	}
+
+	return crc;
+}
+
+
+/*
+ * Function to encode a frame of n time stamps of bank starting at index
+ * first. Returns the number of bytes written to out
+ * ___________________________________________________________________________
+ */
+static uint_fast16_t timestamp_encode_frame(uint8_t* out,
+		uint_fast8_t bank, uint_fast16_t first, uint_fast16_t n) {
+
+	/* the raw frame (time stamps and CRC) */
+	uint8_t			frame[TIMESTAMP_COBS_STAMPS * 6 + 2];
+	uint_fast16_t	len = 0;
+	uint_fast16_t	lenOut = 0;
+	uint_fast16_t	i;
+	uint_fast16_t	j;
+	uint16_t		crc = 0xFFFF;
+
+	for (i = first; i < first + n; i++) {
+		uint32_t ticks = TIMESTAMP_TICKS(bank, i);
+		uint16_t tag = TIMESTAMP_TAG(bank, i);
+		frame[len++] = (uint8_t)ticks;
+		frame[len++] = (uint8_t)(ticks >> 8);
+		frame[len++] = (uint8_t)(ticks >> 16);
+		frame[len++] = (uint8_t)(ticks >> 24);
+		frame[len++] = (uint8_t)tag;
+		frame[len++] = (uint8_t)(tag >> 8);
+	}
+	for (i = 0; i < len; i++) {
+		crc = timestamp_crc16(crc, frame[i]);
+	}
+	frame[len++] = (uint8_t)crc;
+	frame[len++] = (uint8_t)(crc >> 8);
+
+	/* COBS: each zero byte (and the end) is replaced by the distance to
+	 * the next one (frames never reach 254 bytes, see above) */
+	for (i = 0; i <= len; i = j + 1) {
+		for (j = i; j < len && frame[j] != 0; j++);
+		out[lenOut++] = (uint8_t)(j - i + 1);
+		for (; i < j; i++) {
+			out[lenOut++] = frame[i];
+		}
+	}
+
+	/* delimiter */
+	out[lenOut++] = 0;
+
+	return lenOut;
+}
+
+#else
+    #error "Unknown TIMESTAMP_FORMAT"
+#endif
+
+
+/*
+ * Function to encode the next unit (a time stamp or a frame of time stamps)
+ * of the n time stamps of bank from index *i on. Returns the number of
+ * bytes written to out (up to TIMESTAMP_UNIT_MAX) and advances *i
+ * ___________________________________________________________________________
+ */
+static uint_fast16_t timestamp_encode_next(uint8_t* out,
+		uint_fast8_t bank, uint_fast16_t* i, uint_fast16_t n) {
+
+	uint_fast16_t	len;
+
+#if TIMESTAMP_FORMAT == TIMESTAMP_FORMAT_COBS
+	uint_fast16_t	k = (n - *i < TIMESTAMP_COBS_STAMPS)
+			? n - *i : TIMESTAMP_COBS_STAMPS;
+	len = timestamp_encode_frame(out, bank, *i, k);
+	*i += k;
+#elif TIMESTAMP_FORMAT == TIMESTAMP_FORMAT_HEX
+	(void)n;
+	len = timestamp_encode_stamp(out, timestamp_buf[bank][*i]);
+	*i += 1;
+#else
+	(void)n;
+	len = timestamp_encode_stamp(out,
+			TIMESTAMP_TICKS(bank, *i), TIMESTAMP_TAG(bank, *i));
+	*i += 1;
+#endif
+
+	return len;
+}
+
+
+#ifdef TIMESTAMP_ASYNC
+
+/*
+ * Function to encode time stamps of the bank being sent out into the
+ * transmit ring as far as there is space, and to start sending out the
+ * next contiguous region of the ring unless still busy. Returns non-zero
+ * if anything is left to send (including the region just started)
+ * ___________________________________________________________________________
+ */
+static uint_fast8_t timestamp_tx_pump(void) {
+
+	uint8_t				unit[TIMESTAMP_UNIT_MAX];
+	ringbuffer_span_t	span[2];
+
+	while (timestamp_tx_i < timestamp_tx_n
+			&& ringbuffer_get_space(&timestamp_tx) >= TIMESTAMP_UNIT_MAX) {
+		ringbuffer_write(&timestamp_tx, unit, timestamp_encode_next(unit,
+				timestamp_tx_bank, &timestamp_tx_i, timestamp_tx_n));
+	}
+
+	if (timestamp_tx_len == 0
+			&& ringbuffer_peek(&timestamp_tx, span, (size_t)-1) > 0) {
+		timestamp_tx_len = span[0].len;
+		timestamp_start_tx(span[0].data, span[0].len);
+	}
+
+	return timestamp_tx_i < timestamp_tx_n
+			|| ringbuffer_get_len(&timestamp_tx) != 0;
+}
+
+
+/*
+ * Function to finish a flush, i.e. to report its completion
+ * ___________________________________________________________________________
+ */
+static void timestamp_tx_done(void) {
+
+	timestamp_tx_active = 0;
+
+	if (timestamp_flush_done != 0) {
+		(*timestamp_flush_done)();
+	}
+}
+
+
+/*
+ * Function to keep the transmission going until a region is in flight or
+ * the whole bank has been sent out. Regions completed synchronously (i.e.
+ * timestamp_tx_complete() called from within timestamp_start_tx()) are
+ * continued iteratively
+ * ___________________________________________________________________________
+ */
+static void timestamp_tx_run(void) {
+
+	timestamp_tx_running = 1;
+
+	for (;;) {
+
+		if (!timestamp_tx_pump()) {
+			/* the whole bank has been sent out */
+			timestamp_tx_running = 0;
+			timestamp_tx_done();
+			return;
+		}
+
+		if (timestamp_tx_len != 0) {
+			timestamp_tx_running = 0;
+			/* unless the region completed just before clearing the flag,
+			 * timestamp_tx_complete() continues from here */
+			if (timestamp_tx_len != 0 || !timestamp_tx_active) {
+				return;
+			}
+			timestamp_tx_running = 1;
+		}
+	}
+}
+
+
+/*
+ * Function to be called when the bytes handed to timestamp_start_tx() have
+ * been sent out (e.g. from the DMA or TX-empty interrupt)
+ * ___________________________________________________________________________
+ */
+void timestamp_tx_complete(void) {
+
+	ringbuffer_consume(&timestamp_tx, timestamp_tx_len);
+	timestamp_tx_len = 0;
+
+	if (!timestamp_tx_running) {
+		timestamp_tx_run();
+	}
+}
+
+
+/*
+ * Function to start sending out all time stamps from the buffer without
+ * waiting for them to be sent out
+ * ___________________________________________________________________________
+ */
+int timestamp_flush_async(void) {
+
+	if (timestamp_tx_active) {
+		/* previous flush still in flight */
+		return -1;
+	}
+
+	timestamp_tx_active = 1;
+
+	if (timestamp_n > 0) {
+
+		/* hand the bank over and continue recording into the other one */
+		timestamp_tx_bank = timestamp_bank;
+		timestamp_tx_n = timestamp_n;
+		timestamp_tx_i = 0;
+		timestamp_bank = (uint_fast8_t)(timestamp_bank ^ 1);
+		timestamp_n = 0;
+
+		timestamp_tx_run();
+
+	} else {
+
+		/* nothing to send out, but completed all the same */
+		timestamp_tx_done();
+	}
+
+	return 0;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+int timestamp_flush_busy(void) {
+
+	return timestamp_tx_active != 0;
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+void timestamp_set_flush_callback(timestamp_flush_done_t flush_done) {
+
+	timestamp_flush_done = flush_done;
+}
+
+
+/*
+ * Function to send out all time stamps from the buffer and clear the buffer
+ * ___________________________________________________________________________
+ */
+void timestamp_flush(void) {
+
+	/* wait for a previous flush, start this one and wait for it, too */
+	while (timestamp_flush_async() != 0);
+	while (timestamp_tx_active);
+}
+
+#else
+
+/*
+ * Function to send out all time stamps from the buffer and clear the buffer
+ * ___________________________________________________________________________
+ */
+void timestamp_flush(void) {
+
+	uint8_t			unit[TIMESTAMP_UNIT_MAX];
+	uint_fast16_t	len;
+	uint_fast16_t	i = 0;
+	uint_fast16_t	j;
+
+    /* iterate over all time stamps in the buffer */
+	while (i < timestamp_n) {
+		len = timestamp_encode_next(unit, 0, &i, timestamp_n);
+		for (j = 0; j < len; j++) {
+			timestamp_send_byte(unit[j]);
+		}
+	}
+
+    /* clear the buffer */
+	timestamp_n = 0;
+}
+
+#endif
@@ -0,0 +1,149 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development 
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TIMESTAMP_H_
+#define TIMESTAMP_H_
+
+#include <stdint.h>
+
+/*
+ * Compile-time options (to be defined when compiling timestamp.c):
+ *
+ *  TIMESTAMP_N_MAX     size of the time stamp buffer (default: 128)
+ *  TIMESTAMP_COMPACT   keep ticks and tags in separate arrays instead of
+ *                      an array of (padded) timestamp_t
+ *                      (time stamps in TIMESTAMP_FORMAT_HEX are always
+ *                      kept packed in 4 bytes each, as they are sent out)
+ *  TIMESTAMP_FORMAT    the format time stamps are sent out in:
+ *
+ *   TIMESTAMP_FORMAT_HEX     8 hex digits and CR LF per time stamp: an
+ *                            8-bit tag and the lower 24 bits of the ticks
+ *                            (all 32 bits without a tag), 10 bytes
+ *   TIMESTAMP_FORMAT_BASE64  8 base64 digits and CR LF per time stamp: the
+ *                            32-bit ticks followed by the 16-bit tag, 10
+ *                            bytes (the default)
+ *   TIMESTAMP_FORMAT_COBS    binary frames of up to TIMESTAMP_COBS_STAMPS
+ *                            (default: 32) time stamps of 6 bytes each
+ *                            (ticks and tag, little-endian), followed by a
+ *                            CRC-16/CCITT (over the stamps, little-endian),
+ *                            COBS encoded and terminated by a zero byte:
+ *                            about 6 bytes per time stamp. A decoder can
+ *                            resynchronize at the next zero byte and drops
+ *                            frames failing the CRC.
+ *
+ *  TIMESTAMP_ASYNC     flush without blocking (see timestamp_flush_async()):
+ *                      time stamps are recorded into one of two buffers
+ *                      while the other one is encoded into a transmit ring
+ *                      (see ringbuffers/ringbuffer.h) of TIMESTAMP_TX_SIZE
+ *                      bytes (default: 512) and sent out by an externally
+ *                      defined timestamp_start_tx(data, len), e.g. by DMA
+ *                      or a TX-empty interrupt chain, instead of
+ *                      timestamp_send_byte()
+ */
+
+#define TIMESTAMP_FORMAT_HEX        1
+#define TIMESTAMP_FORMAT_BASE64     2
+#define TIMESTAMP_FORMAT_COBS       3
+
+#ifndef TIMESTAMP_FORMAT
+    #define TIMESTAMP_FORMAT TIMESTAMP_FORMAT_BASE64
+#endif
+
+/* the number of bits of the ticks sent out per (tagged) time stamp */
+#if TIMESTAMP_FORMAT == TIMESTAMP_FORMAT_HEX
+    #define TIMESTAMP_TICKS_BITS    24
+#else
+    #define TIMESTAMP_TICKS_BITS    32
+#endif
+
+/*
+ * Epoch markers extend the ticks sent out to a 64-bit timeline (the ticks
+ * wrap around every 2^TIMESTAMP_TICKS_BITS ticks, e.g. after 0.2 s with
+ * TIMESTAMP_FORMAT_HEX or 51 s otherwise at 84 MHz). A marker is a pair of
+ * time stamps taken from the same 64-bit tick count: one with the tag
+ * TIMESTAMP_TAG_EPOCH carrying the bits above TIMESTAMP_TICKS_BITS in
+ * place of the ticks, followed by one with the tag TIMESTAMP_TAG_EPOCH_TICKS
+ * carrying the ticks. Between markers, decoders assume that subsequent time
+ * stamps are less than one wrap-around apart.
+ */
+#define TIMESTAMP_TAG_EPOCH_TICKS   0xFFFB
+#define TIMESTAMP_TAG_EPOCH         0xFFFC
+
+/* the tag of time stamps set by timestamp_set_notag() (reserved) */
+#define TIMESTAMP_TAG_NONE          0xFFFF
+
+
+typedef struct {
+
+    uint32_t ticks;
+
+    uint16_t tag;
+
+} timestamp_t;
+
+
+/* Function to set a time stamp, i.e. write a time stamp to the buffer
+ * (with TIMESTAMP_FORMAT_HEX, only the lower 8 bits of tag are sent) */
+void timestamp_set(uint_fast16_t tag);
+
+/* Function to set a time stamp without a tag */
+void timestamp_set_notag(void);
+
+/* Function to set an epoch marker (see above), to be called periodically,
+ * at least once per wrap-around of the ticks sent out (as it also counts
+ * the wrap-arounds of the 32-bit tick counter to extend it to 64 bits).
+ * With TIMESTAMP_FORMAT_HEX, tags 0xFB and 0xFC are reserved for markers */
+void timestamp_set_epoch(void);
+
+/* Function to send out all time stamps from the buffer and clear the buffer */
+void timestamp_flush(void);
+
+#ifdef TIMESTAMP_ASYNC
+
+/* type of the function called once a flush has completed */
+typedef void (*timestamp_flush_done_t)(void);
+
+/* Function to start sending out all time stamps from the buffer without
+ * waiting: recording continues into the second buffer right away. Returns
+ * 0 on success and -1 if the previous flush is still in flight. Every
+ * successful call is followed by exactly one call of the flush callback,
+ * i.e. right away if the buffer is empty */
+int timestamp_flush_async(void);
+
+/* Function to return non-zero while a flush is in flight */
+int timestamp_flush_busy(void);
+
+/* Function to set the function called once a flush has completed (from the
+ * context calling timestamp_tx_complete(), or timestamp_flush_async() if
+ * the flush completes right away) */
+void timestamp_set_flush_callback(timestamp_flush_done_t flush_done);
+
+/* Function to be called when the bytes handed to timestamp_start_tx() have
+ * been sent out, e.g. from the DMA or TX-empty interrupt */
+void timestamp_tx_complete(void);
+
+#endif
+
+
+#endif
@@ -0,0 +1,198 @@
+/*
+ * MICRO-MAN-TOOLS: A set of tools for embedded system development
+ * Copyright (C) 2016 Andreas Walz
+ *
+ * Author: Andreas Walz (andreas.walz@hs-offenburg.de)
+ *
+ * This file is part of MICRO-MAN-TOOLS.
+ *
+ * THE-MAN-TOOLS are free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * THE-MAN-TOOLS are distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with THE-MAN-TOOLS; if not, see <http://www.gnu.org/licenses/>
+ * or write to the Free Software Foundation, Inc., 51 Franklin Street,
+ * Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+/*
+ * Host round trip test of the time stamp formats against timestamps.py,
+ * e.g.
+ *
+ *  gcc -DTIMESTAMP_FORMAT=TIMESTAMP_FORMAT_HEX -o timestamp_test \
+ *          timestamp_test.c timestamp.c
+ *  ./timestamp_test stamps.out stamps.exp
+ *  python timestamp_test.py stamps.out stamps.exp
+ *
+ * (with the same TIMESTAMP_* options as timestamp.c, and
+ * ../ringbuffers/ringbuffer.c with TIMESTAMP_ASYNC). Time stamps with
+ * random tags are set from a simulated 64-bit tick counter advancing in
+ * random steps across many wrap-arounds, with epoch markers in between,
+ * and flushed in random portions. The encoded output is written to the
+ * first file, the format and the expected (64-bit) ticks and tags to the
+ * second one.
+ */
+
+#include "timestamp.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/* the number of time stamps to set */
+#define TEST_STAMPS         20000
+
+/* the number of buffer slots used per flush at most (of the default
+ * TIMESTAMP_N_MAX, leaving room for a time stamp and an epoch marker) */
+#define TEST_FLUSH_MAX      125
+
+
+/* the name of the format (as told to timestamp_test.py) */
+#if TIMESTAMP_FORMAT == TIMESTAMP_FORMAT_HEX
+    #define TEST_FORMAT     "hex"
+#elif TIMESTAMP_FORMAT == TIMESTAMP_FORMAT_BASE64
+    #define TEST_FORMAT     "base64"
+#else
+    #define TEST_FORMAT     "cobs"
+#endif
+
+
+/* the simulated 64-bit tick counter */
+static uint64_t ticks = 16;
+
+/* the file the encoded time stamps are sent to */
+static FILE* out;
+
+
+/*
+ * Function to return the lower 32 bits of the simulated tick counter
+ * ___________________________________________________________________________
+ */
+uint32_t timestamp_get_ticks(void) {
+
+    return (uint32_t)ticks;
+}
+
+
+#ifdef TIMESTAMP_ASYNC
+
+/*
+ * Function to send out len bytes at data (completing right away)
+ * ___________________________________________________________________________
+ */
+void timestamp_start_tx(const uint8_t* data, size_t len) {
+
+    fwrite(data, 1, len, out);
+    timestamp_tx_complete();
+}
+
+#else
+
+/*
+ * Function to send out one byte
+ * ___________________________________________________________________________
+ */
+void timestamp_send_byte(uint8_t byte) {
+
+    fputc(byte, out);
+}
+
+#endif
+
+
+/*
+ * Function to send out all time stamps from the buffer
+ * ___________________________________________________________________________
+ */
+static void test_flush(void) {
+
+#ifdef TIMESTAMP_ASYNC
+    timestamp_flush_async();
+#else
+    timestamp_flush();
+#endif
+}
+
+
+/*
+ * ___________________________________________________________________________
+ */
+int main(int argc, char* argv[]) {
+
+    /* the ticks wrap around every 2^TIMESTAMP_TICKS_BITS ticks */
+    uint64_t wrap = (uint64_t)1 << TIMESTAMP_TICKS_BITS;
+
+    /* the ticks of the last epoch marker */
+    uint64_t ticksEpoch = 0;
+
+    FILE* expected;
+    int nflush = 0;
+    int i;
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <output> <expected>\n", argv[0]);
+        return 1;
+    }
+    out = fopen(argv[1], "wb");
+    expected = fopen(argv[2], "w");
+    if (out == 0 || expected == 0) {
+        fprintf(stderr, "cannot open output files\n");
+        return 1;
+    }
+
+    srand(1);
+    fprintf(expected, "# %s\n", TEST_FORMAT);
+
+    for (i = 0; i < TEST_STAMPS; ++i) {
+
+        /* mostly short steps, sometimes close to a wrap-around */
+        uint64_t step = (rand() % 10 == 0)
+                ? wrap / 2 + (uint64_t)rand() % (wrap / 4)
+                : (uint64_t)rand() % 1000;
+
+        /* an epoch marker at least once per wrap-around of the 32-bit tick
+         * counter (which timestamp_set_epoch() counts), and now and then */
+        if (ticks + step - ticksEpoch >= ((uint64_t)1 << 32)
+                || rand() % 20 == 0) {
+            timestamp_set_epoch();
+            ticksEpoch = ticks;
+            nflush += 2;
+        }
+        ticks += step;
+
+        /* any tag but the ones reserved for markers (and without a tag
+         * except for the hex format, which does not tell those apart) */
+#if TIMESTAMP_FORMAT == TIMESTAMP_FORMAT_HEX
+        uint_fast16_t tag = (uint_fast16_t)(rand() % 0xFB);
+        timestamp_set(tag);
+#else
+        uint_fast16_t tag = (uint_fast16_t)(rand() % 0xFFFB);
+        if (rand() % 10 == 0) {
+            tag = TIMESTAMP_TAG_NONE;
+            timestamp_set_notag();
+        } else {
+            timestamp_set(tag);
+        }
+#endif
+        fprintf(expected, "%llu %u\n", (unsigned long long)ticks,
+                (unsigned int)tag);
+
+        if (++nflush >= TEST_FLUSH_MAX || rand() % 20 == 0) {
+            test_flush();
+            nflush = 0;
+        }
+    }
+    test_flush();
+
+    fclose(out);
+    fclose(expected);
+
+    return 0;
+}
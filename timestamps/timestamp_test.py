@@ -0,0 +1,59 @@
+#!/usr/bin/python
+
+#
+# Round trip test of the time stamp formats: decodes the output of
+# timestamp_test.c with timestamps.py and compares the time stamps (with
+# 64-bit ticks) to the ones expected. Exits non-zero on any mismatch.
+#
+# Usage: timestamp_test.py <output> <expected>
+#
+
+import sys
+from timestamps import *
+
+
+#
+# _____________________________________________________________________________
+#
+def main(argv):
+
+    if len(argv) != 2:
+        print "Wrong number of arguments. Stopping."
+        print "Expecting <output> <expected>"
+        return 2
+
+    # the format (first line) and the expected ticks and tags
+    f = open(argv[1], 'r')
+    fmt = f.readline().strip('# \n')
+    expected = [tuple(int(v) for v in line.split()) for line in f]
+    f.close()
+
+    timestamps = TimestampList(None, base64=(fmt == 'base64'),
+                               cobs=(fmt == 'cobs'))
+    timestamps.parseFile(argv[0])
+
+    errors = 0
+    if len(timestamps) != len(expected):
+        print 'Expected {0} time stamps, decoded {1}' \
+            .format(len(expected), len(timestamps))
+        errors += 1
+    for i, (ts, (ticks, tag)) in enumerate(zip(timestamps, expected)):
+        if ts.counter != ticks or ts.tag != tag:
+            if errors < 10:
+                print 'Time stamp {0}: expected {1:X}:{2:X}, decoded {3:X}:{4:X}' \
+                    .format(i, tag, ticks, ts.tag, ts.counter)
+            errors += 1
+    if timestamps.dropped > 0:
+        print 'Dropped {0} frame(s)'.format(timestamps.dropped)
+        errors += 1
+
+    print '{0}: {1} time stamps, {2}'.format(fmt, len(expected),
+                                             'ok' if errors == 0 else 'FAILED')
+    return 0 if errors == 0 else 1
+
+
+#
+# _____________________________________________________________________________
+#
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -1,5 +1,7 @@
 #!/usr/bin/python
 
+import struct
+
 
 #
 # _____________________________________________________________________________
@@ -16,6 +18,10 @@ class Timestamp(object):
 
 class TimestampHex(Timestamp):
 
+    # 8-bit tag and the lower 24 bits of the ticks
+    bits = 24
+    tagBits = 8
+
     def parseCode(self, code):
         if not isinstance(code, str) or len(code) != 8:
             raise Exception('Invalid code "{0}"'.format(code))
@@ -26,11 +32,15 @@ class TimestampHex(Timestamp):
         return '{0:02X}{1:06X}'.format(self.tag, self.counter % 16**6)
 
     def __str__(self):
-        return '{0:02X}:{1:06X}'.format(self.tag, self.counter % 16**6)
+        return '{0:02X}:{1:06X}'.format(self.tag, self.counter)
 
 
 class TimestampBase64(Timestamp):
 
+    # 32-bit ticks and 16-bit tag
+    bits = 32
+    tagBits = 16
+
     def parseCode(self, code):
         if not isinstance(code, str) or len(code) != 8:
             raise Exception('Invalid code "{0}"'.format(code))
@@ -43,8 +53,53 @@ class TimestampBase64(Timestamp):
                 .format(self.counter % 16**8, self.tag).encode('base64')
 
     def __str__(self):
-        return '{1:04X}:{0:08X}' \
-                .format(self.counter % 16**8, self.tag)
+        return '{1:04X}:{0:08X}'.format(self.counter, self.tag)
+
+
+#
+# _____________________________________________________________________________
+#
+def crc16(data, crc=0xFFFF):
+    # CRC-16/CCITT (polynomial 0x1021) as computed by timestamp.c
+    for byte in bytearray(data):
+        crc ^= byte << 8
+        for i in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def decodeCobs(block):
+    # returns the decoded frame or None if the block is malformed
+    block = bytearray(block)
+    frame = bytearray()
+    i = 0
+    while i < len(block):
+        code = block[i]
+        if code == 0 or i + code > len(block):
+            return None
+        frame += block[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(block):
+            frame.append(0)
+    return frame
+
+
+class TimestampCobs(Timestamp):
+
+    # ticks (32 bits) and tag (16 bits), little-endian
+    size = 6
+    bits = 32
+    tagBits = 16
+
+    def parseBytes(self, data):
+        self.counter, self.tag = struct.unpack('<IH', bytes(data))
+
+    def getCode(self):
+        return struct.pack('<IH', self.counter % 16**8, self.tag)
+
+    def __str__(self):
+        return '{1:04X}:{0:08X}'.format(self.counter, self.tag)
 
 
 #
@@ -52,9 +107,16 @@ class TimestampBase64(Timestamp):
 #
 class TimestampList(object):
 
-    def __init__(self, timestamps=None, base64=False):
+    # tags of epoch markers (see timestamp.h)
+    TAG_EPOCH_TICKS = 0xFFFB
+    TAG_EPOCH = 0xFFFC
+
+    def __init__(self, timestamps=None, base64=False, cobs=False):
         self.timestamps = timestamps
         self.base64 = base64
+        self.cobs = cobs
+        # the number of frames dropped due to a CRC or framing error
+        self.dropped = 0
 
     def __len__(self):
         return len(self.timestamps) if self.timestamps is not None else 0
@@ -70,18 +132,74 @@ class TimestampList(object):
             return self.timestamps[index]
 
     def parseCodes(self, codes):
-        offset = 0
         self.timestamps = []
         for code in codes.split('\n'):
             ts = TimestampBase64() if self.base64 else TimestampHex()
             ts.parseCode(code)
-            if len(self.timestamps):
-                if (ts.counter + offset) < self.timestamps[-1].counter:
-                    offset += 16**8 if self.base64 else 16**6
-            ts.applyDelta(offset)
             self.timestamps += [ts]
+        self.unwrap()
+
+    def parseFrames(self, data):
+        # COBS encoded frames of time stamps followed by a CRC, each
+        # terminated by a zero byte (frames cut off at either end of the
+        # capture or corrupted on the line are dropped)
+        self.timestamps = []
+        self.dropped = 0
+        blocks = bytes(data).split(b'\0')
+        for block in blocks[1:-1] if len(blocks) > 1 else []:
+            frame = decodeCobs(block)
+            size = TimestampCobs.size
+            if frame is None or len(frame) < 2 \
+                    or (len(frame) - 2) % size != 0 \
+                    or crc16(frame[:-2]) != frame[-2] | (frame[-1] << 8):
+                self.dropped += 1
+                continue
+            for i in range(0, len(frame) - 2, size):
+                ts = TimestampCobs()
+                ts.parseBytes(frame[i:i + size])
+                self.timestamps += [ts]
+        self.unwrap()
+
+    def unwrap(self):
+        # extend the counters of freshly parsed time stamps, which wrap
+        # around after 2**bits ticks, to a monotonic timeline (starting in
+        # epoch 0 until the first epoch marker). Epoch markers, i.e. a
+        # TAG_EPOCH stamp directly followed by a TAG_EPOCH_TICKS stamp, are
+        # removed, any other stamp is unwrapped as is
+        last = None
+        timestamps = []
+        i = 0
+        while i < len(self.timestamps):
+            ts = self.timestamps[i]
+            wrap = 2**ts.bits
+            tagMask = 2**ts.tagBits - 1
+            if last is not None:
+                # the counter only moves forward (modulo 2**bits)
+                estimate = last + (ts.counter - last) % wrap
+            else:
+                estimate = ts.counter
+            if i + 1 < len(self.timestamps) \
+                    and ts.tag == TimestampList.TAG_EPOCH & tagMask \
+                    and self.timestamps[i + 1].tag \
+                        == TimestampList.TAG_EPOCH_TICKS & tagMask:
+                # an epoch marker tells the absolute counter (carrying the
+                # bits above the counter in place of the ticks)
+                last = ts.counter * wrap + self.timestamps[i + 1].counter
+                i += 2
+                continue
+            ts.counter = estimate
+            timestamps += [ts]
+            last = ts.counter
+            i += 1
+        self.timestamps = timestamps
 
     def parseFile(self, filename):
+        if self.cobs:
+            f = open(filename, 'rb')
+            # the delimiter before the first frame is implied
+            self.parseFrames(b'\0' + f.read())
+            f.close()
+            return
         f = open(filename, 'r')
         lines = [line.strip() for line in f]
         codes = '\n'.join([line for line in lines